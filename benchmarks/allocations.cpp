@@ -0,0 +1,27 @@
+#include "allocations.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// The allocation functions are defined in their own translation unit so that
+// they are not inlined in the code measured.
+static std::atomic<size_t> counter{0};
+
+void* operator new(const size_t size) {
+  ++counter;
+  if (auto* result = std::malloc(size == 0 ? 1 : size)) {
+    return result;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t /*unused*/) noexcept { std::free(ptr); }
+
+namespace gshhg {
+
+auto allocations() noexcept -> size_t { return counter.load(); }
+
+}  // namespace gshhg
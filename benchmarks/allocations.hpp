@@ -0,0 +1,10 @@
+#pragma once
+#include <cstddef>
+
+namespace gshhg {
+
+/// Gets the number of memory allocations made by the process since its
+/// start. The global allocation functions are replaced to count them.
+auto allocations() noexcept -> size_t;
+
+}  // namespace gshhg
@@ -0,0 +1,92 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "gshhg.hpp"
+
+namespace gshhg {
+
+/// Coordinates of the points processed by a benchmark
+using Points = std::pair<std::vector<double>, std::vector<double>>;
+
+/// Gets the directory containing the shapefiles: the one set by the
+/// environment variable GSHHG_DATA_DIR or, by default, the one of the test
+/// suite which contains only the crude resolution.
+inline auto data_directory() -> std::string {
+  const auto* result = std::getenv("GSHHG_DATA_DIR");
+  return result != nullptr ? result : GSHHG_DATA_DIR;
+}
+
+/// Gets the shorelines of the crude resolution, loaded once.
+inline auto shorelines() -> const GSHHG& {
+  static const auto instance =
+      GSHHG(data_directory(), std::string("crude"), {}, {});
+  return instance;
+}
+
+/// Gets points uniformly distributed over the globe
+///
+/// @param size Number of points to generate.
+/// @param seed Seed of the generator.
+inline auto uniform_points(const size_t size, const uint64_t seed = 0)
+    -> Points {
+  auto generator = std::mt19937_64(seed);
+  auto lon = std::uniform_real_distribution<double>(-180, 180);
+  auto lat = std::uniform_real_distribution<double>(-90, 90);
+  auto result =
+      std::make_pair(std::vector<double>(size), std::vector<double>(size));
+  for (size_t ix = 0; ix < size; ++ix) {
+    result.first[ix] = lon(generator);
+    result.second[ix] = lat(generator);
+  }
+  return result;
+}
+
+/// Gets points located less than a tenth of a degree from the shorelines:
+/// the worst case of the mask, whose candidate polygons must be tested.
+///
+/// @param size Number of points to generate.
+inline auto coastal_points(const size_t size) -> Points {
+  auto generator = std::mt19937_64(1);
+  auto offset = std::uniform_real_distribution<double>(-0.1, 0.1);
+  auto result = uniform_points(size, 1);
+  auto& lon = result.first;
+  auto& lat = result.second;
+  shorelines().nearest(lon.data(), lat.data(), size, lon.data(), lat.data());
+  for (size_t ix = 0; ix < size; ++ix) {
+    lon[ix] += offset(generator);
+    lat[ix] = std::clamp(lat[ix] + offset(generator), -90.0, 90.0);
+  }
+  return result;
+}
+
+/// Gets points at sea, located more than 500 km from the shorelines: the
+/// worst case of the nearest point search, whose bound is loose.
+///
+/// @param size Number of points to generate.
+inline auto open_ocean_points(const size_t size) -> Points {
+  const auto& instance = shorelines();
+  const auto strategy = Andoyer();
+  auto generator = std::mt19937_64(2);
+  auto lon = std::uniform_real_distribution<double>(-180, 180);
+  auto lat = std::uniform_real_distribution<double>(-90, 90);
+  auto result = Points();
+  result.first.reserve(size);
+  result.second.reserve(size);
+  while (result.first.size() < size) {
+    const auto x = lon(generator);
+    const auto y = lat(generator);
+    if (instance.mask(x, y) == 0 &&
+        instance.distance_to_nearest(x, y, strategy) > 500e3) {
+      result.first.push_back(x);
+      result.second.push_back(y);
+    }
+  }
+  return result;
+}
+
+}  // namespace gshhg
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "dataset.hpp"
+#include "thread.hpp"
+
+namespace gshhg {
+
+// Number of points processed by an iteration
+static constexpr size_t kSize = 65536;
+
+// Gets the points processed, uniformly distributed over the globe
+static auto points() -> const Points& {
+  static const auto result = uniform_points(kSize);
+  return result;
+}
+
+// Registers the numbers of threads tested: the powers of two up to the
+// number of CPUs, and this number.
+static void threads(benchmark::internal::Benchmark* benchmark) {
+  const auto cpus =
+      std::max<int64_t>(std::thread::hardware_concurrency(), 1);
+  for (int64_t item = 1; item < cpus; item *= 2) {
+    benchmark->Arg(item);
+  }
+  benchmark->Arg(cpus);
+}
+
+static void mask(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto& [lon, lat] = points();
+  auto result = std::vector<int8_t>(kSize);
+
+  for (auto _ : state) {
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          for (auto ix = start; ix < end; ++ix) {
+            result[ix] = instance.mask(lon[ix], lat[ix]);
+          }
+        },
+        kSize, static_cast<size_t>(state.range(0)));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+static void nearest(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto& [lon, lat] = points();
+  auto nearest_lon = std::vector<double>(kSize);
+  auto nearest_lat = std::vector<double>(kSize);
+
+  for (auto _ : state) {
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          instance.nearest(lon.data() + start, lat.data() + start,
+                           end - start, nearest_lon.data() + start,
+                           nearest_lat.data() + start);
+        },
+        kSize, static_cast<size_t>(state.range(0)));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+}  // namespace gshhg
+
+BENCHMARK(gshhg::mask)->Apply(gshhg::threads)->UseRealTime();
+BENCHMARK(gshhg::nearest)->Apply(gshhg::threads)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <exception>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "dataset.hpp"
+
+namespace gshhg {
+
+// Resolutions of the data set
+static const auto kResolutions = std::array<const char*, 5>{
+    "crude", "low", "intermediate", "high", "full"};
+
+// Sets of hierarchical levels loaded: land, land and lakes, all the levels.
+static const auto kLevels = std::array<std::vector<int>, 3>{
+    std::vector<int>{1}, std::vector<int>{1, 2},
+    std::vector<int>{1, 2, 3, 4, 5, 6}};
+
+// Loads the shapefiles of a resolution and a set of levels. The resolutions
+// not available in the data directory are skipped.
+static void load(benchmark::State& state, const bool cache) {
+  const auto resolution = std::string(kResolutions[state.range(0)]);
+  const auto& levels = kLevels[state.range(1)];
+  auto label = resolution + "/L";
+  for (const auto item : levels) {
+    label += std::to_string(item);
+  }
+  state.SetLabel(label);
+
+  auto directory = std::optional<std::string>();
+  if (cache) {
+    directory =
+        (std::filesystem::temp_directory_path() / "gshhg-benchmark").string();
+    std::filesystem::create_directories(*directory);
+  }
+  for (auto _ : state) {
+    try {
+      auto instance = GSHHG(data_directory(), resolution, levels, {}, {},
+                            directory);
+      benchmark::DoNotOptimize(instance.points());
+    } catch (const std::exception& error) {
+      state.SkipWithError(error.what());
+      break;
+    }
+  }
+}
+
+static void load_shapefiles(benchmark::State& state) { load(state, false); }
+
+// After the first iteration, the shorelines are mapped from the cache.
+static void load_cache(benchmark::State& state) { load(state, true); }
+
+}  // namespace gshhg
+
+BENCHMARK(gshhg::load_shapefiles)
+    ->ArgsProduct({{0, 1, 2, 3, 4}, {0, 1, 2}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(gshhg::load_cache)
+    ->ArgsProduct({{0, 1, 2, 3, 4}, {0, 1, 2}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,69 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "allocations.hpp"
+#include "dataset.hpp"
+
+namespace gshhg {
+
+// Sets the number of memory allocations per query made by the loop.
+static void count_allocations(benchmark::State& state, const size_t start) {
+  state.counters["allocations"] = benchmark::Counter(
+      static_cast<double>(allocations() - start),
+      benchmark::Counter::kAvgIterations);
+}
+
+static void nearest(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto points = uniform_points(4096);
+  auto ix = size_t(0);
+
+  const auto start = allocations();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        instance.nearest(points.first[ix], points.second[ix]));
+    ix = (ix + 1) % points.first.size();
+  }
+  count_allocations(state, start);
+}
+
+static void k_nearest(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto points = uniform_points(4096);
+  const auto k = static_cast<size_t>(state.range(0));
+  auto lon = std::vector<double>(k);
+  auto lat = std::vector<double>(k);
+  auto ix = size_t(0);
+
+  const auto start = allocations();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(instance.nearest(
+        points.first[ix], points.second[ix], k, lon.data(), lat.data()));
+    ix = (ix + 1) % points.first.size();
+  }
+  count_allocations(state, start);
+}
+
+static void batch_nearest(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto points = uniform_points(size);
+  auto lon = std::vector<double>(size);
+  auto lat = std::vector<double>(size);
+
+  for (auto _ : state) {
+    instance.nearest(points.first.data(), points.second.data(), size,
+                     lon.data(), lat.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace gshhg
+
+BENCHMARK(gshhg::nearest);
+BENCHMARK(gshhg::k_nearest)->Arg(1)->Arg(8)->Arg(32);
+BENCHMARK(gshhg::batch_nearest)->Arg(4096);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,157 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "dataset.hpp"
+
+namespace gshhg {
+
+// Number of points processed by an iteration
+static constexpr size_t kSize = 4096;
+
+// Distributions of the points processed
+static const auto kDistributions =
+    std::array<const char*, 3>{"uniform", "coastal", "open ocean"};
+
+// Gets the points of a distribution
+static auto points(const int64_t distribution) -> const Points& {
+  static const auto result = std::array<Points, 3>{
+      uniform_points(kSize), coastal_points(kSize), open_ocean_points(kSize)};
+  return result[distribution];
+}
+
+static void mask(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto& [lon, lat] = points(state.range(0));
+  state.SetLabel(kDistributions[state.range(0)]);
+
+  for (auto _ : state) {
+    for (size_t ix = 0; ix < kSize; ++ix) {
+      benchmark::DoNotOptimize(instance.mask(lon[ix], lat[ix]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+static void nearest(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto& [lon, lat] = points(state.range(0));
+  auto nearest_lon = std::vector<double>(kSize);
+  auto nearest_lat = std::vector<double>(kSize);
+  state.SetLabel(kDistributions[state.range(0)]);
+
+  for (auto _ : state) {
+    instance.nearest(lon.data(), lat.data(), kSize, nearest_lon.data(),
+                     nearest_lat.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+// Mask of a global grid whose step, in minutes of arc, is the argument.
+static void rasterize_mask(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto step = static_cast<double>(state.range(0)) / 60;
+  const auto nx = static_cast<size_t>(360 / step);
+  const auto ny = static_cast<size_t>(180 / step) + 1;
+  auto mask = std::vector<uint8_t>(nx * ny);
+
+  for (auto _ : state) {
+    instance.rasterize_mask(-180, -90, step, step, nx, ny, mask.data(), 1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * nx * ny);
+}
+
+// Distances of a global grid of 15 minutes of arc, searched exactly or not
+// depending on the argument.
+static void rasterize_distance_to_nearest(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto exact = state.range(0) != 0;
+  const auto nx = size_t(1440);
+  const auto ny = size_t(721);
+  auto distance = std::vector<double>(nx * ny);
+  state.SetLabel(exact ? "exact" : "approximate");
+
+  for (auto _ : state) {
+    instance.rasterize_distance_to_nearest(-180, -90, 0.25, 0.25, nx, ny,
+                                           Andoyer(), exact, distance.data(),
+                                           1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * nx * ny);
+}
+
+template <class Strategy>
+static void distance_to_nearest(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto& [lon, lat] = points(state.range(0));
+  const auto strategy = Strategy();
+  auto distance = std::vector<double>(kSize);
+  state.SetLabel(kDistributions[state.range(0)]);
+
+  for (auto _ : state) {
+    instance.distance_to_nearest(lon.data(), lat.data(), kSize, strategy,
+                                 distance.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+// Points located within the radius, in kilometers, given as argument.
+static void within_distance(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto& [lon, lat] = points(0);
+  const auto radius = static_cast<double>(state.range(0)) * 1e3;
+  const auto strategy = Vincenty();
+  auto result = std::unique_ptr<bool[]>(new bool[kSize]);
+
+  for (auto _ : state) {
+    instance.within_distance(lon.data(), lat.data(), kSize, radius, strategy,
+                             result.get());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+// Mask, nearest points and distances of the points computed together
+static void classify(benchmark::State& state) {
+  const auto& instance = shorelines();
+  const auto& [lon, lat] = points(state.range(0));
+  auto level = std::vector<uint8_t>(kSize);
+  auto nearest_lon = std::vector<double>(kSize);
+  auto nearest_lat = std::vector<double>(kSize);
+  auto distance = std::vector<double>(kSize);
+  state.SetLabel(kDistributions[state.range(0)]);
+
+  for (auto _ : state) {
+    instance.classify(lon.data(), lat.data(), kSize, Andoyer(), level.data(),
+                      nearest_lon.data(), nearest_lat.data(),
+                      distance.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+}  // namespace gshhg
+
+BENCHMARK(gshhg::mask)->DenseRange(0, 2);
+BENCHMARK(gshhg::nearest)->DenseRange(0, 2);
+BENCHMARK(gshhg::rasterize_mask)
+    ->Arg(15)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(gshhg::rasterize_distance_to_nearest)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(gshhg::distance_to_nearest<gshhg::Andoyer>)->DenseRange(0, 2);
+BENCHMARK(gshhg::distance_to_nearest<gshhg::Haversine>)->DenseRange(0, 2);
+BENCHMARK(gshhg::distance_to_nearest<gshhg::Thomas>)->DenseRange(0, 2);
+BENCHMARK(gshhg::distance_to_nearest<gshhg::Vincenty>)->DenseRange(0, 2);
+BENCHMARK(gshhg::within_distance)->Arg(1)->Arg(50)->Arg(500);
+BENCHMARK(gshhg::classify)->DenseRange(0, 2);
+
+BENCHMARK_MAIN();
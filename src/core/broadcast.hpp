@@ -1,7 +1,11 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace gshhg {
 
@@ -88,4 +92,123 @@ void check_array_ndim(const std::string& name, const int64_t ndim,
   check_array_ndim(args...);
 }
 
+/// Computes the shape of two arrays broadcast together, following the
+/// broadcasting rules of NumPy.
+///
+/// @param name1 name of the variable containing the first array
+/// @param a1 first array
+/// @param name2 name of the variable containing the second array
+/// @param a2 second array
+/// @return the shape of the broadcast arrays
+/// @throw std::invalid_argument if the arrays cannot be broadcast together
+template <typename Array1, typename Array2>
+auto broadcast_shape(const std::string& name1, const Array1& a1,
+                     const std::string& name2, const Array2& a2)
+    -> std::vector<int64_t> {
+  const auto ndim = std::max<int64_t>(a1.ndim(), a2.ndim());
+  auto result = std::vector<int64_t>(ndim);
+  for (int64_t ix = 0; ix < ndim; ++ix) {
+    // The dimensions are aligned on the last one.
+    const auto dim1 = ix - (ndim - a1.ndim());
+    const auto dim2 = ix - (ndim - a2.ndim());
+    const auto n1 = dim1 < 0 ? int64_t(1) : int64_t(a1.shape(dim1));
+    const auto n2 = dim2 < 0 ? int64_t(1) : int64_t(a2.shape(dim2));
+    if (n1 != n2 && n1 != 1 && n2 != 1) {
+      throw std::invalid_argument(
+          name1 + ", " + name2 +
+          " could not be broadcast together with shapes " + ndarray_shape(a1) +
+          " " + ndarray_shape(a2));
+    }
+    result[ix] = n1 == 1 ? n2 : n1;
+  }
+  return result;
+}
+
+/// Reads the elements of an array broadcast to a shape, in the C order of
+/// this shape. The elements are read by following the strides of the array,
+/// without copying it.
+///
+/// @tparam T type of the elements
+template <typename T>
+class BroadcastReader {
+ public:
+  /// Default constructor
+  ///
+  /// @param a array to read
+  /// @param shape shape to which the array is broadcast
+  template <typename Array>
+  BroadcastReader(const Array& a, std::vector<int64_t> shape)
+      : data_(reinterpret_cast<const char*>(a.data())),
+        shape_(std::move(shape)),
+        strides_(shape_.size(), 0),
+        index_(shape_.size(), 0),
+        ptr_(data_) {
+    const auto offset = static_cast<int64_t>(shape_.size()) - a.ndim();
+    auto stride = static_cast<int64_t>(sizeof(T));
+    contiguous_ = a.ndim() == static_cast<int64_t>(shape_.size());
+    for (auto ix = static_cast<int64_t>(a.ndim()) - 1; ix >= 0; --ix) {
+      // The broadcast dimensions are read with a null stride.
+      if (a.shape(ix) != 1) {
+        strides_[offset + ix] = a.strides(ix);
+      }
+      contiguous_ &= a.shape(ix) == shape_[offset + ix] &&
+                     (a.shape(ix) == 1 || a.strides(ix) == stride);
+      stride *= a.shape(ix);
+    }
+  }
+
+  /// Moves to the element at the given position of the C order of the shape
+  void seek(size_t position) {
+    ptr_ = data_;
+    for (auto ix = shape_.size(); ix-- > 0;) {
+      // An empty shape has no element to move to.
+      if (shape_[ix] == 0) {
+        return;
+      }
+      index_[ix] = static_cast<int64_t>(position % shape_[ix]);
+      position /= shape_[ix];
+      ptr_ += index_[ix] * strides_[ix];
+    }
+  }
+
+  /// Reads the current element and moves to the next one
+  auto next() -> T {
+    const auto result = *reinterpret_cast<const T*>(ptr_);
+    for (auto ix = shape_.size(); ix-- > 0;) {
+      ptr_ += strides_[ix];
+      if (++index_[ix] < shape_[ix]) {
+        break;
+      }
+      ptr_ -= strides_[ix] * shape_[ix];
+      index_[ix] = 0;
+    }
+    return result;
+  }
+
+  /// Gets the elements of the positions [start, end) as a contiguous array:
+  /// the array read if its elements are stored in the C order of the shape,
+  /// otherwise a copy of the elements into the given buffer.
+  auto read(const size_t start, const size_t end,
+            std::vector<T>& buffer) const -> const T* {
+    if (contiguous_) {
+      return reinterpret_cast<const T*>(data_) + start;
+    }
+    auto reader = *this;
+    reader.seek(start);
+    buffer.resize(end - start);
+    for (auto& item : buffer) {
+      item = reader.next();
+    }
+    return buffer.data();
+  }
+
+ private:
+  const char* data_;
+  std::vector<int64_t> shape_;
+  std::vector<int64_t> strides_;
+  std::vector<int64_t> index_;
+  const char* ptr_;
+  bool contiguous_{false};
+};
+
 }  // namespace gshhg
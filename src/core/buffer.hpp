@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace gshhg {
+
+/// Read-only contiguous array whose values are either owned by the instance
+/// or stored in a memory owned by another object (e.g. a memory mapped file).
+///
+/// @tparam T Type of the values stored.
+template <typename T>
+class Buffer {
+ public:
+  /// Default constructor
+  Buffer() = default;
+
+  /// Build a buffer owning its values
+  explicit Buffer(std::vector<T>&& values)
+      : values_(std::move(values)),
+        data_(values_.data()),
+        size_(values_.size()) {}
+
+  /// Build a buffer referencing values stored elsewhere. The memory
+  /// referenced must outlive the buffer.
+  Buffer(const T* data, const size_t size) : data_(data), size_(size) {}
+
+  /// The owned values are not copied: the pointer to the data would be
+  /// shared between the two instances.
+  Buffer(const Buffer&) = delete;
+  auto operator=(const Buffer&) -> Buffer& = delete;
+
+  /// Moving a vector doesn't move its values, so the pointer to the data
+  /// remains valid.
+  Buffer(Buffer&&) noexcept = default;
+  auto operator=(Buffer&&) noexcept -> Buffer& = default;
+
+  /// Destructor
+  ~Buffer() = default;
+
+  /// Gets the number of values stored
+  [[nodiscard]] inline auto size() const noexcept -> size_t { return size_; }
+
+  /// Returns true if the buffer is empty
+  [[nodiscard]] inline auto empty() const noexcept -> bool {
+    return size_ == 0;
+  }
+
+  /// Gets a pointer to the values
+  [[nodiscard]] inline auto data() const noexcept -> const T* { return data_; }
+
+  /// Gets the value at the given position
+  [[nodiscard]] inline auto operator[](const size_t index) const noexcept
+      -> const T& {
+    return data_[index];
+  }
+
+  /// Gets the first value
+  [[nodiscard]] inline auto begin() const noexcept -> const T* {
+    return data_;
+  }
+
+  /// Gets the position following the last value
+  [[nodiscard]] inline auto end() const noexcept -> const T* {
+    return data_ + size_;
+  }
+
+  /// Gets the last value
+  [[nodiscard]] inline auto back() const noexcept -> const T& {
+    return data_[size_ - 1];
+  }
+
+ private:
+  std::vector<T> values_{};
+  const T* data_{nullptr};
+  size_t size_{0};
+};
+
+}  // namespace gshhg
@@ -0,0 +1,388 @@
+#include "gshhg.hpp"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <type_traits>
+
+namespace gshhg {
+
+// Signature of the cache files
+static constexpr char kMagic[8] = {'G', 'S', 'H', 'H', 'G', 'B', 'I', 'N'};
+
+// Version of the cache file layout. It must be incremented each time the
+// layout changes, so that the files written by previous versions are
+// rebuilt.
+static constexpr uint32_t kVersion = 7;
+
+// Detects the files written on a machine with a different byte order.
+static constexpr uint32_t kByteOrder = 0x01020304;
+
+static_assert(std::is_trivially_copyable_v<Point>);
+static_assert(std::is_trivially_copyable_v<Box>);
+static_assert(std::is_trivially_copyable_v<Cartesian>);
+
+// Append the binary representation of a value to a buffer
+template <typename T>
+static inline auto append(std::string& buffer, const T& value) -> void {
+  static_assert(std::is_trivially_copyable_v<T>);
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Write an array of values into a binary stream
+template <typename T>
+static inline auto write(std::ostream& stream, const T* values,
+                         const size_t size) -> void {
+  static_assert(std::is_trivially_copyable_v<T>);
+  stream.write(reinterpret_cast<const char*>(values),
+               static_cast<std::streamsize>(sizeof(T) * size));
+}
+
+// Write a value into a binary stream
+template <typename T>
+static inline auto write(std::ostream& stream, const T& value) -> void {
+  write(stream, &value, 1);
+}
+
+// Read an array of values from a mapped file, starting at the given
+// position which is advanced past the values read.
+template <typename T>
+static inline auto read(const MappedFile& file, uint64_t& position, T* values,
+                        const size_t size) -> bool {
+  static_assert(std::is_trivially_copyable_v<T>);
+  const auto bytes = sizeof(T) * size;
+  if (position > file.size() || bytes > file.size() - position) {
+    return false;
+  }
+  std::memcpy(values, file.data() + position, bytes);
+  position += bytes;
+  return true;
+}
+
+// Read a value from a mapped file
+template <typename T>
+static inline auto read(const MappedFile& file, uint64_t& position, T& value)
+    -> bool {
+  return read(file, position, &value, 1);
+}
+
+auto GSHHG::cache_key(
+    const Resolution resolution,
+    const std::vector<std::pair<std::filesystem::path, uint8_t>>& shapefiles)
+    const -> std::string {
+  auto result = std::string();
+  append(result, static_cast<char>(resolution));
+  append(result, static_cast<uint64_t>(shapefiles.size()));
+  for (const auto& [path, level] : shapefiles) {
+    // The size and the modification date of the shapefiles identify the
+    // version of the data set read.
+    append(result, level);
+    append(result, static_cast<uint64_t>(std::filesystem::file_size(path)));
+    append(result, static_cast<int64_t>(std::filesystem::last_write_time(path)
+                                            .time_since_epoch()
+                                            .count()));
+  }
+  append(result, bbox_.has_value());
+  if (bbox_) {
+    append(result, bbox_->min_corner());
+    append(result, bbox_->max_corner());
+  }
+  return result;
+}
+
+auto GSHHG::cache_path(const std::string& dirname,
+                       const std::string& resolution, const std::string& key)
+    -> std::filesystem::path {
+  // FNV-1a hash of the key
+  auto hash = uint64_t(14695981039346656037ULL);
+  for (const auto item : key) {
+    hash ^= static_cast<uint8_t>(item);
+    hash *= 1099511628211ULL;
+  }
+  std::stringstream ss;
+  ss << "GSHHS_" << resolution << "_" << std::hex << std::setw(16)
+     << std::setfill('0') << hash << ".bin";
+  return std::filesystem::path(dirname) / ss.str();
+}
+
+// Sections of the cache file, stored after the header and the section
+// directory. Each section is a contiguous array queried in place once the
+// file is mapped in memory.
+enum Section : size_t {
+  kLevels,
+  kEnvelopes,
+  kParents,
+  kOffsets,
+  kEcef,
+  kX,
+  kY,
+  kBlockRanges,
+  kSlabs,
+  kSlabOffsets,
+  kSlabEdges,
+  kPolygonBounds,
+  kPolygonIndices,
+  kPolygonLevels,
+  kSegmentBounds,
+  kSegmentIndices,
+  kSegmentLevels,
+  kMaxDepth,
+  kSections
+};
+
+// Alignment of the sections in the file
+static constexpr uint64_t kAlignment = 64;
+
+// Location of a section in the file
+struct SectionEntry {
+  uint64_t offset;
+  uint64_t bytes;
+};
+
+// Gets the memory area of a buffer
+template <typename T>
+static inline auto area(const Buffer<T>& buffer)
+    -> std::pair<const char*, uint64_t> {
+  static_assert(std::is_trivially_copyable_v<T>);
+  return {reinterpret_cast<const char*>(buffer.data()),
+          sizeof(T) * buffer.size()};
+}
+
+// Builds a view on a section of the mapped file. Returns false if the
+// section doesn't hold an array of T.
+template <typename T>
+static inline auto view(const MappedFile& file, const SectionEntry& entry,
+                        Buffer<T>& buffer) -> bool {
+  static_assert(std::is_trivially_copyable_v<T>);
+  if (entry.offset % kAlignment != 0 || entry.bytes % sizeof(T) != 0 ||
+      entry.offset > file.size() || entry.bytes > file.size() - entry.offset) {
+    return false;
+  }
+  buffer = Buffer<T>(reinterpret_cast<const T*>(file.data() + entry.offset),
+                     entry.bytes / sizeof(T));
+  return true;
+}
+
+auto GSHHG::read_cache(const std::filesystem::path& path,
+                       const std::string& key) -> bool {
+  auto file = std::shared_ptr<MappedFile>();
+  try {
+    file = std::make_shared<MappedFile>(path.string());
+  } catch (const std::system_error&) {
+    return false;
+  }
+
+  // Header
+  auto position = uint64_t(0);
+  char magic[sizeof(kMagic)];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t size;
+  if (!read(*file, position, magic, sizeof(magic)) ||
+      std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      !read(*file, position, version) || version != kVersion ||
+      !read(*file, position, byte_order) || byte_order != kByteOrder ||
+      !read(*file, position, size) || size != key.size()) {
+    return false;
+  }
+  auto buffer = std::string(size, '\0');
+  auto sections = std::array<SectionEntry, kSections>();
+  if (!read(*file, position, buffer.data(), size) || buffer != key ||
+      !read(*file, position, sections.data(), sections.size())) {
+    return false;
+  }
+
+  // Views on the sections
+  auto levels = Buffer<uint8_t>();
+  auto envelopes = Buffer<Box>();
+  auto parents = Buffer<uint32_t>();
+  auto offsets = Buffer<uint64_t>();
+  auto ecef = Buffer<Cartesian>();
+  auto x = Buffer<double>();
+  auto y = Buffer<double>();
+  auto block_ranges = Buffer<std::array<double, 2>>();
+  auto slabs = Buffer<Slabs>();
+  auto slab_offsets = Buffer<uint64_t>();
+  auto slab_edges = Buffer<double>();
+  auto polygon_bounds = Buffer<PackedRTree<2>::Bounds>();
+  auto polygon_indices = Buffer<uint32_t>();
+  auto polygon_levels = Buffer<uint64_t>();
+  auto segment_bounds = Buffer<PackedRTree<3>::Bounds>();
+  auto segment_indices = Buffer<uint32_t>();
+  auto segment_levels = Buffer<uint64_t>();
+  auto max_depth = Buffer<double>();
+  if (!view(*file, sections[kLevels], levels) ||
+      !view(*file, sections[kEnvelopes], envelopes) ||
+      !view(*file, sections[kParents], parents) ||
+      !view(*file, sections[kOffsets], offsets) ||
+      !view(*file, sections[kEcef], ecef) ||
+      !view(*file, sections[kX], x) || !view(*file, sections[kY], y) ||
+      !view(*file, sections[kBlockRanges], block_ranges) ||
+      !view(*file, sections[kSlabs], slabs) ||
+      !view(*file, sections[kSlabOffsets], slab_offsets) ||
+      !view(*file, sections[kSlabEdges], slab_edges) ||
+      !view(*file, sections[kPolygonBounds], polygon_bounds) ||
+      !view(*file, sections[kPolygonIndices], polygon_indices) ||
+      !view(*file, sections[kPolygonLevels], polygon_levels) ||
+      !view(*file, sections[kSegmentBounds], segment_bounds) ||
+      !view(*file, sections[kSegmentIndices], segment_indices) ||
+      !view(*file, sections[kSegmentLevels], segment_levels) ||
+      !view(*file, sections[kMaxDepth], max_depth)) {
+    return false;
+  }
+
+  // The files are written atomically, but may have been truncated or
+  // altered since: the sizes of the arrays, and the indexes they store, must
+  // be consistent. The other values are not read until queried.
+  if (envelopes.size() != levels.size() || parents.size() != levels.size() ||
+      offsets.size() != levels.size() + 1 || offsets[0] != 0 ||
+      offsets.back() != x.size() || ecef.size() != x.size() ||
+      y.size() != x.size() ||
+      block_ranges.size() != (x.size() + kEdgeBlock - 1) / kEdgeBlock ||
+      slabs.size() != levels.size() || slab_offsets.empty() ||
+      slab_offsets[0] != 0 || slab_offsets.back() * 4 != slab_edges.size() ||
+      max_depth.size() != 1) {
+    return false;
+  }
+  for (size_t ix = 0; ix < levels.size(); ++ix) {
+    if (offsets[ix] > offsets[ix + 1] ||
+        (parents[ix] != kRoot && parents[ix] >= levels.size()) ||
+        slabs[ix].first + slabs[ix].size >= slab_offsets.size()) {
+      return false;
+    }
+  }
+  for (size_t ix = 1; ix < slab_offsets.size(); ++ix) {
+    if (slab_offsets[ix - 1] > slab_offsets[ix]) {
+      return false;
+    }
+  }
+
+  try {
+    auto polygon_rtree = PackedRTree<2>(std::move(polygon_bounds),
+                                        std::move(polygon_indices),
+                                        std::move(polygon_levels));
+    auto rtree = PackedRTree<3>(std::move(segment_bounds),
+                                std::move(segment_indices),
+                                std::move(segment_levels));
+    if (polygon_rtree.size() != levels.size() ||
+        rtree.size() > x.size()) {
+      return false;
+    }
+    // The leaves store the index of a polygon or of the first point of a
+    // segment.
+    for (size_t ix = 0; ix < polygon_rtree.size(); ++ix) {
+      if (polygon_rtree.indices()[ix] >= levels.size()) {
+        return false;
+      }
+    }
+    for (size_t ix = 0; ix < rtree.size(); ++ix) {
+      if (rtree.indices()[ix] + uint64_t(1) >= x.size()) {
+        return false;
+      }
+    }
+    polygon_rtree_ = std::move(polygon_rtree);
+    rtree_ = std::move(rtree);
+  } catch (const std::invalid_argument&) {
+    return false;
+  }
+
+  levels_ = std::move(levels);
+  envelopes_ = std::move(envelopes);
+  parents_ = std::move(parents);
+  offsets_ = std::move(offsets);
+  ecef_ = std::move(ecef);
+  x_ = std::move(x);
+  y_ = std::move(y);
+  block_ranges_ = std::move(block_ranges);
+  slabs_ = std::move(slabs);
+  slab_offsets_ = std::move(slab_offsets);
+  slab_edges_ = std::move(slab_edges);
+  max_depth_ = max_depth[0];
+  file_ = std::move(file);
+  return true;
+}
+
+void GSHHG::write_cache(const std::filesystem::path& path,
+                        const std::string& key) const {
+  std::filesystem::create_directories(path.parent_path());
+
+  // The file is written under a temporary name and then renamed, so that the
+  // processes sharing the cache never read a partially written file.
+  auto temporary = path;
+  temporary += ".tmp" + std::to_string(std::random_device()());
+
+  auto areas = std::array<std::pair<const char*, uint64_t>, kSections>();
+  areas[kLevels] = area(levels_);
+  areas[kEnvelopes] = area(envelopes_);
+  areas[kParents] = area(parents_);
+  areas[kOffsets] = area(offsets_);
+  areas[kEcef] = area(ecef_);
+  areas[kX] = area(x_);
+  areas[kY] = area(y_);
+  areas[kBlockRanges] = area(block_ranges_);
+  areas[kSlabs] = area(slabs_);
+  areas[kSlabOffsets] = area(slab_offsets_);
+  areas[kSlabEdges] = area(slab_edges_);
+  areas[kPolygonBounds] = area(polygon_rtree_.bounds());
+  areas[kPolygonIndices] = area(polygon_rtree_.indices());
+  areas[kPolygonLevels] = area(polygon_rtree_.levels());
+  areas[kSegmentBounds] = area(rtree_.bounds());
+  areas[kSegmentIndices] = area(rtree_.indices());
+  areas[kSegmentLevels] = area(rtree_.levels());
+  areas[kMaxDepth] = {reinterpret_cast<const char*>(&max_depth_),
+                      sizeof(max_depth_)};
+
+  // Location of the sections, aligned after the header and the section
+  // directory.
+  auto offset = static_cast<uint64_t>(sizeof(kMagic) + sizeof(kVersion) +
+                                      sizeof(kByteOrder) + sizeof(uint64_t) +
+                                      key.size() +
+                                      sizeof(SectionEntry) * kSections);
+  auto sections = std::array<SectionEntry, kSections>();
+  for (size_t ix = 0; ix < kSections; ++ix) {
+    offset = (offset + kAlignment - 1) / kAlignment * kAlignment;
+    sections[ix] = {offset, areas[ix].second};
+    offset += areas[ix].second;
+  }
+
+  try {
+    std::ofstream stream;
+    stream.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    stream.open(temporary, std::ios::binary);
+
+    // Header
+    write(stream, kMagic, sizeof(kMagic));
+    write(stream, kVersion);
+    write(stream, kByteOrder);
+    write(stream, static_cast<uint64_t>(key.size()));
+    write(stream, key.data(), key.size());
+    write(stream, sections.data(), sections.size());
+
+    // Sections
+    for (size_t ix = 0; ix < kSections; ++ix) {
+      const auto padding =
+          sections[ix].offset - static_cast<uint64_t>(stream.tellp());
+      write(stream, std::string(padding, '\0').data(), padding);
+      write(stream, areas[ix].first, areas[ix].second);
+    }
+    stream.close();
+  } catch (...) {
+    auto ec = std::error_code();
+    std::filesystem::remove(temporary, ec);
+    throw;
+  }
+
+  // The file replaces the one found inconsistent, if any. If it can't be
+  // renamed, e.g. because another process has created the file in the
+  // meantime on a system forbidding to replace it, it's discarded.
+  auto ec = std::error_code();
+  std::filesystem::rename(temporary, path, ec);
+  if (ec) {
+    std::filesystem::remove(temporary, ec);
+  }
+}
+
+}  // namespace gshhg
@@ -1,7 +1,30 @@
 #include "geometry.hpp"
 
+#include <cstdint>
+#include <cstring>
+
 #include "math.hpp"
 
+// The batch conversions are compiled for the AVX-512 and AVX2 instruction
+// sets in addition to the default one, the best version being selected at
+// runtime.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+    defined(__linux__)
+#define GSHHG_TARGET_CLONES \
+  __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define GSHHG_TARGET_CLONES
+#endif
+
+// The kernels must be inlined in the loops to be vectorized.
+#if defined(_MSC_VER)
+#define GSHHG_ALWAYS_INLINE __forceinline
+#elif defined(__GNUC__)
+#define GSHHG_ALWAYS_INLINE __attribute__((always_inline)) inline
+#else
+#define GSHHG_ALWAYS_INLINE inline
+#endif
+
 namespace gshhg {
 
 // Global variables of Earth's geometric constants (WGS84)
@@ -17,35 +40,267 @@ const double E = std::sqrt((A * A - B * B) / (A * A));
 // Second Eccentricity
 const double SE = sqrt((A * A - B * B) / (B * B));
 
-Cartesian geodetic_2_cartesian(const GeodeticRadian& point) {
-  const auto cos_x = std::cos(point.get<0>());
-  const auto sin_x = std::sin(point.get<0>());
-  const auto cos_y = std::cos(point.get<1>());
-  const auto sin_y = std::sin(point.get<1>());
+// The trigonometric functions below are written without branches, so that
+// the loops calling them are vectorized. They are within two ulps of the
+// standard library over the range of the geodetic coordinates.
+
+// Largest magnitude of the angles reduced accurately by sin_cos
+static constexpr double kMaxAngle = 1e5;
+
+// Computes the sine and the cosine of an angle, in radians, whose magnitude
+// is less than kMaxAngle.
+static GSHHG_ALWAYS_INLINE auto sin_cos(const double x, double& sin,
+                                        double& cos) -> void {
+  // Rounding of x * 2/π to the nearest integer: the two lowest bits of the
+  // shifted value give the quadrant of the angle.
+  constexpr double kShift = 6755399441055744.0;  // 1.5 * 2^52
+  const auto shifted = x * 0.63661977236758134308 + kShift;
+  const auto q = shifted - kShift;
+  auto bits = uint64_t(0);
+  std::memcpy(&bits, &shifted, sizeof(bits));
+  const auto quadrant = bits & 3U;
+
+  // Cody-Waite reduction to [-π/4, π/4]
+  const auto r = ((x - q * 1.57079632673412561417e+00) -
+                  q * 6.07710050630396597660e-11) -
+                 q * 2.02226624871116645580e-21;
+  const auto z = r * r;
+
+  // Minimax polynomials of the Cephes library
+  const auto s =
+      r + r * z *
+              (((((1.58962301576546568060e-10 * z -
+                   2.50507477628578072866e-8) *
+                      z +
+                  2.75573136213857245213e-6) *
+                     z -
+                 1.98412698295895385996e-4) *
+                    z +
+                8.33333333332211858878e-3) *
+                   z -
+               1.66666666666666307295e-1);
+  const auto c =
+      1.0 - 0.5 * z +
+      z * z *
+          (((((-1.13585365213876817300e-11 * z + 2.08757008419747316778e-9) *
+                  z -
+              2.75573141792967388112e-7) *
+                 z +
+             2.48015872888517045348e-5) *
+                z -
+            1.38888888888730564116e-3) *
+               z +
+           4.16666666666665929218e-2);
+
+  const auto swap = (quadrant & 1U) != 0;
+  sin = swap ? c : s;
+  cos = swap ? s : c;
+  sin = (quadrant & 2U) != 0 ? -sin : sin;
+  cos = ((quadrant + 1) & 2U) != 0 ? -cos : cos;
+}
+
+// Computes the arc tangent of y/x using the signs of the arguments to
+// determine the quadrant of the result.
+static GSHHG_ALWAYS_INLINE auto arctan2(const double y, const double x)
+    -> double {
+  // Bits of π/4 lost by its double representation
+  constexpr double kMoreBits = 6.123233995736765886130e-17;
+  constexpr double kPi4 = 7.85398163397448309616e-1;
+  constexpr double kPi2 = 1.57079632679489661923e+0;
+  constexpr double kPi = 3.14159265358979323846e+0;
+
+  // Reduction to the first octant
+  const auto ax = std::fabs(x);
+  const auto ay = std::fabs(y);
+  const auto swap = ax < ay;
+  const auto min = swap ? ax : ay;
+  const auto max = swap ? ay : ax;
+  const auto t = min / (max == 0 ? 1.0 : max);
+
+  // Reduction to [0, 0.66]
+  const auto reduce = t > 0.66;
+  const auto u = (reduce ? t - 1.0 : t) / (reduce ? t + 1.0 : 1.0);
+  const auto z = u * u;
+
+  // Rational approximation of the Cephes library
+  const auto p = ((((-8.750608600031904122785e-1 * z -
+                     1.615753718733365076637e1) *
+                        z -
+                    7.500855792314704667340e1) *
+                       z -
+                   1.228866684490136173410e2) *
+                      z -
+                  6.485021904942025371773e1);
+  const auto q = (((((z + 2.485846490142306297962e1) * z +
+                     1.650270098316988542046e2) *
+                        z +
+                    4.328810604912902668951e2) *
+                       z +
+                   4.853903996359136964868e2) *
+                      z +
+                  1.945506571482613964425e2);
+  auto result = u * (z * p / q) + u;
+  result = reduce ? kPi4 + (result + 0.5 * kMoreBits) : result;
+
+  // Back to the quadrant of (x, y)
+  result = swap ? (kPi2 - result) + kMoreBits : result;
+  result = x < 0 ? (kPi - result) + 2 * kMoreBits : result;
+  return std::copysign(result, y);
+}
+
+// Tests if the angles of a point can be reduced by sin_cos. NaN are
+// accepted: their ECEF coordinates are NaN.
+static GSHHG_ALWAYS_INLINE auto in_domain(const double lon, const double lat)
+    -> bool {
+  return !(std::fabs(lon) >= kMaxAngle || std::fabs(lat) >= kMaxAngle);
+}
+
+// Converts geodetic coordinates, given by the sines and the cosines of their
+// angles, into ECEF coordinates
+static GSHHG_ALWAYS_INLINE auto to_cartesian(const double sin_x,
+                                             const double cos_x,
+                                             const double sin_y,
+                                             const double cos_y, double& x,
+                                             double& y, double& z) -> void {
   const auto chi = std::sqrt(1.0 - E * E * sin_y * sin_y);
   const auto a_chi = A / chi;
 
-  return Cartesian(a_chi * cos_y * cos_x, a_chi * cos_y * sin_x,
-                   (a_chi * (1.0 - E * E)) * sin_y);
+  x = a_chi * cos_y * cos_x;
+  y = a_chi * cos_y * sin_x;
+  z = (a_chi * (1.0 - E * E)) * sin_y;
 }
 
-GeodeticRadian cartesian_2_geodetic(const Cartesian& point) {
-  auto x = point.get<0>();
-  auto y = point.get<1>();
-  auto z = point.get<2>();
-  auto p = std::sqrt((x * x) + (y * y));
-  auto theta = std::atan2((z * A), (p * B));
+// Converts geodetic coordinates, in radians, into ECEF coordinates
+static GSHHG_ALWAYS_INLINE auto to_cartesian(const double lon,
+                                             const double lat, double& x,
+                                             double& y, double& z) -> void {
+  double cos_x, sin_x, cos_y, sin_y;
+  sin_cos(lon, sin_x, cos_x);
+  sin_cos(lat, sin_y, cos_y);
+  to_cartesian(sin_x, cos_x, sin_y, cos_y, x, y, z);
+}
+
+// Same as above, for the angles too large to be reduced by sin_cos: the
+// functions of the standard library are used.
+static auto to_cartesian_std(const double lon, const double lat, double& x,
+                             double& y, double& z) -> void {
+  to_cartesian(std::sin(lon), std::cos(lon), std::sin(lat), std::cos(lat), x,
+               y, z);
+}
+
+// Converts ECEF coordinates into geodetic coordinates, in radians, with the
+// Bowring's method.
+static GSHHG_ALWAYS_INLINE auto to_geodetic(const double x, const double y,
+                                            const double z, double& lon,
+                                            double& lat) -> void {
+  const auto p = std::sqrt((x * x) + (y * y));
+
+  // Sine and cosine of the parametric latitude: θ = atan2(z.A, p.B)
+  const auto za = z * A;
+  const auto pb = p * B;
+  const auto h = std::sqrt(za * za + pb * pb);
+  const auto sin_theta = za / h;
+  const auto cos_theta = pb / h;
+
+  lat = arctan2(z + SE * SE * B * (sin_theta * sin_theta * sin_theta),
+                p - E * E * A * (cos_theta * cos_theta * cos_theta));
+  lon = arctan2(y, x);
 
   /* Avoid 0 division error */
-  if (x == 0.0 && y == 0.0) {
-    return GeodeticRadian(0, std::copysign(pi_2<double>(), z));
+  const auto pole = x == 0.0 && y == 0.0;
+  lat = pole ? std::copysign(pi_2<double>(), z) : lat;
+  lon = pole ? 0.0 : lon;
+}
+
+void fast_sin_cos(const double x, double& sin, double& cos) {
+  if (std::fabs(x) >= kMaxAngle) {
+    sin = std::sin(x);
+    cos = std::cos(x);
+    return;
   }
+  sin_cos(x, sin, cos);
+}
+
+double fast_atan2(const double y, const double x) { return arctan2(y, x); }
 
-  auto lat = std::atan2((z + (SE * SE * B * std::pow(std::sin(theta), 3))),
-                        (p - (E * E * A * std::pow(std::cos(theta), 3))));
-  auto lon = std::atan2(y, x);
+Cartesian geodetic_2_cartesian(const GeodeticRadian& point) {
+  double x, y, z;
+  if (in_domain(point.get<0>(), point.get<1>())) {
+    to_cartesian(point.get<0>(), point.get<1>(), x, y, z);
+  } else {
+    to_cartesian_std(point.get<0>(), point.get<1>(), x, y, z);
+  }
+  return Cartesian(x, y, z);
+}
 
+GeodeticRadian cartesian_2_geodetic(const Cartesian& point) {
+  double lon, lat;
+  to_geodetic(point.get<0>(), point.get<1>(), point.get<2>(), lon, lat);
   return GeodeticRadian(lon, lat);
 }
 
-}  // namespace gshhg
\ No newline at end of file
+GSHHG_TARGET_CLONES
+void geodetic_2_cartesian(const double* lon, const double* lat,
+                          const size_t size, double* x, double* y, double* z) {
+  auto valid = true;
+#pragma omp simd reduction(&& : valid)
+  for (size_t ix = 0; ix < size; ++ix) {
+    to_cartesian(lon[ix], lat[ix], x[ix], y[ix], z[ix]);
+    valid = valid && in_domain(lon[ix], lat[ix]);
+  }
+  // The points whose angles are too large are converted again.
+  if (!valid) {
+    for (size_t ix = 0; ix < size; ++ix) {
+      if (!in_domain(lon[ix], lat[ix])) {
+        to_cartesian_std(lon[ix], lat[ix], x[ix], y[ix], z[ix]);
+      }
+    }
+  }
+}
+
+GSHHG_TARGET_CLONES
+void cartesian_2_geodetic(const double* x, const double* y, const double* z,
+                          const size_t size, double* lon, double* lat) {
+#pragma omp simd
+  for (size_t ix = 0; ix < size; ++ix) {
+    to_geodetic(x[ix], y[ix], z[ix], lon[ix], lat[ix]);
+  }
+}
+
+// Tests if the ray leaving the point (px, py) toward the east crosses the
+// edge joining (x0, y0) to (x1, y1).
+static GSHHG_ALWAYS_INLINE auto crosses(const double x0, const double y0,
+                                        const double x1, const double y1,
+                                        const double px, const double py)
+    -> uint32_t {
+  // The abscissa of the crossing is greater than px if the cross product
+  // has the sign of the direction of the edge: no division is needed.
+  const auto cross = (px - x0) * (y1 - y0) - (py - y0) * (x1 - x0);
+  const auto straddles = (y0 > py) != (y1 > py);
+  return (straddles && ((cross < 0) == (y1 > y0))) ? 1U : 0U;
+}
+
+GSHHG_TARGET_CLONES
+bool odd_crossings(const double* x, const double* y, const size_t size,
+                   const double px, const double py) {
+  auto count = uint32_t(0);
+#pragma omp simd reduction(+ : count)
+  for (size_t ix = 0; ix < size; ++ix) {
+    count += crosses(x[ix], y[ix], x[ix + 1], y[ix + 1], px, py);
+  }
+  return (count & 1U) != 0;
+}
+
+GSHHG_TARGET_CLONES
+bool odd_crossings(const double* x0, const double* y0, const double* x1,
+                   const double* y1, const size_t size, const double px,
+                   const double py) {
+  auto count = uint32_t(0);
+#pragma omp simd reduction(+ : count)
+  for (size_t ix = 0; ix < size; ++ix) {
+    count += crosses(x0[ix], y0[ix], x1[ix], y1[ix], px, py);
+  }
+  return (count & 1U) != 0;
+}
+
+}  // namespace gshhg
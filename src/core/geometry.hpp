@@ -1,5 +1,8 @@
 #pragma once
+#include <algorithm>
 #include <boost/geometry.hpp>
+#include <boost/geometry/geometries/register/ring.hpp>
+#include <boost/iterator/iterator_facade.hpp>
 
 #include "math.hpp"
 
@@ -16,6 +19,54 @@ using Point =
 
 using Box = boost::geometry::model::box<Point>;
 using Polygon = boost::geometry::model::polygon<Point>;
+using CartesianSegment = boost::geometry::model::segment<Cartesian>;
+
+// Read-only view on the points of a closed ring whose longitudes and
+// latitudes are stored in separate contiguous arrays. The iterators build
+// the points on the fly.
+struct RingView {
+  class iterator
+      : public boost::iterator_facade<iterator, Point,
+                                      std::random_access_iterator_tag, Point> {
+   public:
+    iterator() = default;
+    iterator(const double* x, const double* y) : x_(x), y_(y) {}
+
+   private:
+    friend class boost::iterator_core_access;
+
+    [[nodiscard]] inline auto dereference() const -> Point {
+      return {*x_, *y_};
+    }
+    [[nodiscard]] inline auto equal(const iterator& other) const -> bool {
+      return x_ == other.x_;
+    }
+    inline void increment() { ++x_, ++y_; }
+    inline void decrement() { --x_, --y_; }
+    inline void advance(const ptrdiff_t n) { x_ += n, y_ += n; }
+    [[nodiscard]] inline auto distance_to(const iterator& other) const
+        -> ptrdiff_t {
+      return other.x_ - x_;
+    }
+
+    const double* x_{};
+    const double* y_{};
+  };
+  using const_iterator = iterator;
+
+  const double* x;
+  const double* y;
+  size_t count;
+
+  [[nodiscard]] inline auto begin() const -> iterator { return {x, y}; }
+  [[nodiscard]] inline auto end() const -> iterator {
+    return {x + count, y + count};
+  }
+  [[nodiscard]] inline auto size() const -> size_t { return count; }
+  [[nodiscard]] inline auto operator[](const size_t ix) const -> Point {
+    return {x[ix], y[ix]};
+  }
+};
 
 using Spheroid = boost::geometry::srs::spheroid<double>;
 
@@ -25,9 +76,41 @@ using Thomas = boost::geometry::strategy::distance::thomas<Spheroid>;
 using Vincenty = boost::geometry::strategy::distance::vincenty<Spheroid>;
 
 
+// Computes the sine and the cosine of an angle, in radians, with the
+// polynomial approximations used by the conversions. The angles whose
+// magnitude reaches 1e5 are computed by the standard library.
+void fast_sin_cos(double x, double& sin, double& cos);
+
+// Computes the arc tangent of y/x, in the quadrant given by the signs of the
+// arguments, with the rational approximation used by the conversions.
+double fast_atan2(double y, double x);
+
 GeodeticRadian cartesian_2_geodetic(const Cartesian& point);
 Cartesian geodetic_2_cartesian(const GeodeticRadian& point);
 
+// Converts arrays of geodetic coordinates, in radians, into ECEF coordinates.
+// The conversions are vectorized.
+void geodetic_2_cartesian(const double* lon, const double* lat, size_t size,
+                          double* x, double* y, double* z);
+
+// Converts arrays of ECEF coordinates into geodetic coordinates, in radians.
+// The conversions are vectorized.
+void cartesian_2_geodetic(const double* x, const double* y, const double* z,
+                          size_t size, double* lon, double* lat);
+
+// Tests if the ray leaving the point (px, py) toward the east crosses an odd
+// number of the edges joining the consecutive points of the arrays x and y,
+// of size + 1 elements. An edge is crossed if its end points are on either
+// side of py, an end point located at py being below. The edges are
+// evaluated several at a time.
+bool odd_crossings(const double* x, const double* y, size_t size, double px,
+                   double py);
+
+// Same as above, for size disjoint edges joining (x0[ix], y0[ix]) to
+// (x1[ix], y1[ix]).
+bool odd_crossings(const double* x0, const double* y0, const double* x1,
+                   const double* y1, size_t size, double px, double py);
+
 inline GeodeticRadian geodetic_2_radian(const GeodeticDegree& point) {
   return GeodeticRadian(radians(point.get<0>()), radians(point.get<1>()),
                         point.get<2>());
@@ -38,4 +121,29 @@ inline GeodeticDegree geodetic_2_degree(const GeodeticRadian& point) {
                         point.get<2>());
 }
 
-}  // namespace gshhg
\ No newline at end of file
+// Gets the point of the segment closest to the given point.
+inline Cartesian closest_point(const Cartesian& point,
+                               const CartesianSegment& segment) {
+  const auto& p0 = segment.first;
+  const auto& p1 = segment.second;
+  const auto dx = p1.get<0>() - p0.get<0>();
+  const auto dy = p1.get<1>() - p0.get<1>();
+  const auto dz = p1.get<2>() - p0.get<2>();
+  const auto norm2 = dx * dx + dy * dy + dz * dz;
+  if (norm2 == 0) {
+    return p0;
+  }
+  // Position of the orthogonal projection of the point on the segment line,
+  // clamped to the segment bounds.
+  const auto t = std::clamp(((point.get<0>() - p0.get<0>()) * dx +
+                             (point.get<1>() - p0.get<1>()) * dy +
+                             (point.get<2>() - p0.get<2>()) * dz) /
+                                norm2,
+                            0.0, 1.0);
+  return Cartesian(p0.get<0>() + t * dx, p0.get<1>() + t * dy,
+                   p0.get<2>() + t * dz);
+}
+
+}  // namespace gshhg
+
+BOOST_GEOMETRY_REGISTER_RING(gshhg::RingView)
@@ -0,0 +1,148 @@
+#pragma once
+#include <algorithm>
+#include <boost/range/iterator_range.hpp>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "geometry.hpp"
+
+namespace gshhg {
+
+/// Regular longitude/latitude raster accelerating the point-in-polygon
+/// classification.
+///
+/// Each cell stores the list of polygons whose edges cross it, sorted in the
+/// order in which they must be tested, and the level of the points of the
+/// cell located in none of these polygons. Cells with an empty list have a
+/// definitive level.
+class MaskGrid {
+ public:
+  /// Range of the polygon indexes stored in a cell
+  using Polygons = boost::iterator_range<const uint32_t*>;
+
+  /// Default constructor
+  ///
+  /// @param extent Geographical area covered by the grid.
+  /// @param step Size of the grid cells, in degrees.
+  MaskGrid(const Box& extent, const double step)
+      : x0_(extent.min_corner().get<0>()),
+        y0_(extent.min_corner().get<1>()),
+        step_(step) {
+    if (!(step > 0)) {
+      throw std::invalid_argument("the grid step must be strictly positive");
+    }
+    nx_ = std::max<size_t>(static_cast<size_t>(std::ceil(
+                               (extent.max_corner().get<0>() - x0_) / step)),
+                           1);
+    ny_ = std::max<size_t>(static_cast<size_t>(std::ceil(
+                               (extent.max_corner().get<1>() - y0_) / step)),
+                           1);
+    levels_.resize(nx_ * ny_, 0);
+    offsets_.resize(nx_ * ny_ + 1, 0);
+  }
+
+  /// Gets the number of cells along the longitude axis
+  [[nodiscard]] inline auto nx() const noexcept -> size_t { return nx_; }
+
+  /// Gets the number of cells along the latitude axis
+  [[nodiscard]] inline auto ny() const noexcept -> size_t { return ny_; }
+
+  /// Gets the box covered by the cell (ix, iy)
+  [[nodiscard]] inline auto box(const size_t ix, const size_t iy) const
+      -> Box {
+    return {{x0_ + static_cast<double>(ix) * step_,
+             y0_ + static_cast<double>(iy) * step_},
+            {x0_ + static_cast<double>(ix + 1) * step_,
+             y0_ + static_cast<double>(iy + 1) * step_}};
+  }
+
+  /// Gets the range [first, last] of the cells along the longitude axis
+  /// touched by the closed interval [min, max]. The range is empty if first
+  /// is greater than last.
+  [[nodiscard]] inline auto x_range(const double min, const double max) const
+      -> std::pair<size_t, size_t> {
+    return range(min - x0_, max - x0_, nx_);
+  }
+
+  /// Gets the range [first, last] of the cells along the latitude axis
+  /// touched by the closed interval [min, max]. The range is empty if first
+  /// is greater than last.
+  [[nodiscard]] inline auto y_range(const double min, const double max) const
+      -> std::pair<size_t, size_t> {
+    return range(min - y0_, max - y0_, ny_);
+  }
+
+  /// Gets the index of the cell containing the point or nothing if the point
+  /// is outside the grid.
+  [[nodiscard]] inline auto cell(const Point& point) const
+      -> std::optional<size_t> {
+    const auto x = (point.get<0>() - x0_) / step_;
+    const auto y = (point.get<1>() - y0_) / step_;
+    // This test also rejects the undefined coordinates.
+    if (!(x >= 0 && y >= 0 && x <= static_cast<double>(nx_) &&
+          y <= static_cast<double>(ny_))) {
+      return {};
+    }
+    // The points on the upper edges of the grid belong to the last cells.
+    const auto ix = std::min(static_cast<size_t>(x), nx_ - 1);
+    const auto iy = std::min(static_cast<size_t>(y), ny_ - 1);
+    return iy * nx_ + ix;
+  }
+
+  /// Gets the level of the points of the cell located outside the polygons
+  /// crossing the cell.
+  [[nodiscard]] inline auto level(const size_t cell) const -> uint8_t {
+    return levels_[cell];
+  }
+
+  /// Gets the polygons crossing the cell.
+  [[nodiscard]] inline auto polygons(const size_t cell) const -> Polygons {
+    return {polygons_.data() + offsets_[cell],
+            polygons_.data() + offsets_[cell + 1]};
+  }
+
+  /// Sets the content of the next cell. The cells must be set in the order
+  /// of their index.
+  inline auto push_back(const size_t cell, const uint8_t level,
+                        const std::vector<uint32_t>& polygons) -> void {
+    levels_[cell] = level;
+    polygons_.insert(polygons_.end(), polygons.begin(), polygons.end());
+    offsets_[cell + 1] = static_cast<uint32_t>(polygons_.size());
+  }
+
+ private:
+  double x0_;
+  double y0_;
+  double step_;
+  size_t nx_{};
+  size_t ny_{};
+
+  // Level of each cell
+  std::vector<uint8_t> levels_{};
+  // Offset, in polygons_, of the polygons crossing each cell
+  std::vector<uint32_t> offsets_{};
+  // Indexes of the polygons crossing the cells
+  std::vector<uint32_t> polygons_{};
+
+  // Cells touched by the closed interval [min, max] expressed relative to
+  // the grid origin.
+  [[nodiscard]] inline auto range(const double min, const double max,
+                                  const size_t size) const
+      -> std::pair<size_t, size_t> {
+    // A tolerance is applied to take into account the rounding errors.
+    constexpr double kEpsilon = 1e-9;
+    auto first = std::ceil(min / step_ - 1 - kEpsilon);
+    auto last = std::floor(max / step_ + kEpsilon);
+    first = std::max(first, 0.0);
+    last = std::min(last, static_cast<double>(size) - 1);
+    if (last < first) {
+      return {1, 0};
+    }
+    return {static_cast<size_t>(first), static_cast<size_t>(last)};
+  }
+};
+
+}  // namespace gshhg
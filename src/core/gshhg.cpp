@@ -2,21 +2,31 @@
 
 #include <shapefil.h>
 
+#include <boost/geometry/algorithms/point_on_surface.hpp>
 #include <boost/geometry/io/svg/svg_mapper.hpp>
+#include <array>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
+
+#include "thread.hpp"
 
 namespace gshhg {
 
 GSHHG::GSHHG(const std::string& dirname,
              const std::optional<std::string>& resolution,
              const std::optional<std::vector<int>>& levels,
-             std::optional<Box> bbox)
+             std::optional<Box> bbox,
+             const std::optional<double>& grid_step,
+             const std::optional<std::string>& cache)
     : bbox_(std::move(bbox)) {
   auto resolution_ident =
       parse_resolution_string(resolution.value_or("intermediate"));
   auto resolution_code = std::string(1, static_cast<char>(resolution_ident));
-  auto points = std::vector<Cartesian>();
+
+  // Paths to the ESRI shape files to load and their hierarchical levels
+  auto shapefiles = std::vector<std::pair<std::filesystem::path, uint8_t>>();
 
   // For all hierarchical levels
   for (auto level = 1; level < 7; ++level) {
@@ -38,28 +48,434 @@ GSHHG::GSHHG(const std::string& dirname,
         dirname / std::filesystem::path(resolution_code) /
         std::filesystem::path("GSHHS_" + resolution_code + "_L" +
                               std::to_string(level) + ".shp");
+    shapefiles.emplace_back(std::move(path), static_cast<uint8_t>(level));
+  }
+
+  // Is the loaded state available in the cache?
+  auto cache_file = std::optional<std::filesystem::path>();
+  auto key = std::string();
+  if (cache) {
+    key = cache_key(resolution_ident, shapefiles);
+    cache_file = cache_path(*cache, resolution_code, key);
+  }
+
+  if (!cache_file || !read_cache(*cache_file, key)) {
+    // The shapefiles are loaded concurrently
+    auto loaded = std::vector<Shorelines>(shapefiles.size());
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          for (auto ix = start; ix < end; ++ix) {
+            const auto& [path, level] = shapefiles[ix];
+            // Load the hierarchical dataset selected
+            load_shp(path.string(), level,
+                     // Level 5 at full resolution must be patched.
+                     resolution_ident == Resolution::kFull && level == 5,
+                     loaded[ix]);
+          }
+        },
+        shapefiles.size(), 0);
+
+    // The polygons are stored in the order of the levels.
+    auto shorelines = Shorelines();
+    for (const auto& item : loaded) {
+      shorelines.extend(item);
+    }
+    index(std::move(shorelines));
+    // The shorelines loaded are used even if the cache file can't be
+    // written, e.g. if the cache directory is read-only.
+    if (cache_file) {
+      try {
+        write_cache(*cache_file, key);
+      } catch (const std::system_error&) {
+      }
+    }
+  }
+
+  if (grid_step) {
+    build_grid(*grid_step);
+  }
+}
 
-    // Load the hierarchical dataset selected
-    load_shp(path.string(), level,
-             // Level 5 at full resolution must be patched.
-             resolution_ident == Resolution::kFull && level == 5, points);
+auto GSHHG::land_levels(const std::vector<int>& levels) -> uint8_t {
+  auto result = uint8_t(0);
+  for (const auto level : levels) {
+    if (level < 1 || level > 6) {
+      throw std::invalid_argument("invalid level: " + std::to_string(level));
+    }
+    result |= static_cast<uint8_t>(1U << static_cast<unsigned>(level));
   }
-  rtree_.reset(new RTree(points));
+  return result;
+}
+
+void GSHHG::Shorelines::push_back(const Polygon& polygon,
+                                  const uint8_t level) {
+  const auto& ring = polygon.outer();
+  levels.push_back(level);
+  envelopes.push_back(boost::geometry::return_envelope<Box>(polygon));
+  points.insert(points.end(), ring.begin(), ring.end());
+  offsets.push_back(points.size());
 }
 
-// Calculate the ECEF coordinates of the polygon points
-static inline auto transform_polygon_points(const Polygon& polygon,
-                                            std::vector<Cartesian>& points)
-    -> void {
-  for (const auto& point : polygon.outer()) {
-    const auto ecef = geodetic_2_cartesian(
-        geodetic_2_radian(GeodeticDegree(point.get<0>(), point.get<1>())));
-    points.emplace_back(ecef);
+void GSHHG::Shorelines::extend(const Shorelines& other) {
+  const auto shift = points.size();
+  levels.insert(levels.end(), other.levels.begin(), other.levels.end());
+  envelopes.insert(envelopes.end(), other.envelopes.begin(),
+                   other.envelopes.end());
+  points.insert(points.end(), other.points.begin(), other.points.end());
+  for (auto it = std::next(other.offsets.begin()); it != other.offsets.end();
+       ++it) {
+    offsets.push_back(*it + shift);
   }
 }
 
+void GSHHG::index(Shorelines&& shorelines) {
+  // The segments are identified by the index of their first point.
+  if (shorelines.points.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("too many points to index");
+  }
+
+  // ECEF coordinates of the points
+  auto ecef = std::vector<Cartesian>(shorelines.points.size());
+  dispatch(
+      [&](const size_t start, const size_t end) {
+        // The points are converted by blocks with the batch functions.
+        constexpr size_t kBlockSize = 256;
+        double lon[kBlockSize], lat[kBlockSize];
+        double x[kBlockSize], y[kBlockSize], z[kBlockSize];
+        for (auto first = start; first < end; first += kBlockSize) {
+          const auto size = std::min(kBlockSize, end - first);
+          for (size_t ix = 0; ix < size; ++ix) {
+            const auto& item = shorelines.points[first + ix];
+            lon[ix] = radians(item.get<0>());
+            lat[ix] = radians(item.get<1>());
+          }
+          geodetic_2_cartesian(lon, lat, size, x, y, z);
+          for (size_t ix = 0; ix < size; ++ix) {
+            ecef[first + ix] = Cartesian(x[ix], y[ix], z[ix]);
+          }
+        }
+      },
+      ecef.size(), 0);
+
+  // Index of the polygon envelopes
+  auto envelopes = std::vector<PackedRTree<2>::Item>();
+  envelopes.reserve(shorelines.envelopes.size());
+  for (size_t ix = 0; ix < shorelines.envelopes.size(); ++ix) {
+    const auto& min_corner = shorelines.envelopes[ix].min_corner();
+    const auto& max_corner = shorelines.envelopes[ix].max_corner();
+    envelopes.emplace_back(
+        PackedRTree<2>::Bounds{min_corner.get<0>(), min_corner.get<1>(),
+                               max_corner.get<0>(), max_corner.get<1>()},
+        static_cast<uint32_t>(ix));
+  }
+  polygon_rtree_ = PackedRTree<2>::build(envelopes);
+
+  // Index of the coastline segments: the segments join the consecutive
+  // points of the rings. The position of the first segment of each ring is
+  // computed first, so that the rings are processed in parallel.
+  const auto polygons = shorelines.levels.size();
+  auto first = std::vector<size_t>(polygons + 1, 0);
+  for (size_t ix = 0; ix < polygons; ++ix) {
+    const auto size = shorelines.offsets[ix + 1] - shorelines.offsets[ix];
+    first[ix + 1] = first[ix] + (size == 0 ? 0 : size - 1);
+  }
+  auto segments = std::vector<PackedRTree<3>::Item>(first.back());
+  dispatch(
+      [&](const size_t start, const size_t end) {
+        for (auto ix = start; ix < end; ++ix) {
+          auto it = segments.begin() + static_cast<ptrdiff_t>(first[ix]);
+          const auto last = shorelines.offsets[ix + 1];
+          for (auto jx = shorelines.offsets[ix]; jx + 1 < last; ++jx, ++it) {
+            const auto& p0 = ecef[jx];
+            const auto& p1 = ecef[jx + 1];
+            *it = {{std::min(p0.get<0>(), p1.get<0>()),
+                    std::min(p0.get<1>(), p1.get<1>()),
+                    std::min(p0.get<2>(), p1.get<2>()),
+                    std::max(p0.get<0>(), p1.get<0>()),
+                    std::max(p0.get<1>(), p1.get<1>()),
+                    std::max(p0.get<2>(), p1.get<2>())},
+                   static_cast<uint32_t>(jx)};
+          }
+        }
+      },
+      polygons, 0);
+  rtree_ = PackedRTree<3>::build(segments);
+
+  // Depth of the segments below the ellipsoid: the sagitta of their chord on
+  // a circle of the smallest radius of curvature of the ellipsoid, that of
+  // the meridians at the equator.
+  constexpr double kMinRadius = 6356752.3142 * 6356752.3142 / 6378137.0;
+  max_depth_ = 0;
+  for (const auto& [bounds, jx] : segments) {
+    const auto half = boost::geometry::distance(ecef[jx], ecef[jx + 1]) / 2;
+    max_depth_ = std::max(
+        max_depth_,
+        kMinRadius - std::sqrt(std::max(
+                         kMinRadius * kMinRadius - half * half, 0.0)));
+  }
+
+  // Coordinates of the points stored in separate arrays, and range of the
+  // latitudes of the blocks of edges.
+  const auto size = shorelines.points.size();
+  auto x = std::vector<double>(size);
+  auto y = std::vector<double>(size);
+  for (size_t ix = 0; ix < size; ++ix) {
+    x[ix] = shorelines.points[ix].get<0>();
+    y[ix] = shorelines.points[ix].get<1>();
+  }
+  auto block_ranges =
+      std::vector<std::array<double, 2>>((size + kEdgeBlock - 1) / kEdgeBlock);
+  for (size_t ix = 0; ix < block_ranges.size(); ++ix) {
+    const auto first = y.begin() + static_cast<ptrdiff_t>(ix * kEdgeBlock);
+    const auto last = y.begin() + static_cast<ptrdiff_t>(std::min<size_t>(
+                                      (ix + 1) * kEdgeBlock + 1, size));
+    const auto [min, max] = std::minmax_element(first, last);
+    block_ranges[ix] = {*min, *max};
+  }
+
+  // The edges of the largest polygons are distributed in about sqrt(n)
+  // latitude bands, n being the number of edges: an edge is stored in all
+  // the bands its latitudes overlap. The horizontal edges, never crossed,
+  // are ignored.
+  auto slabs = std::vector<Slabs>(polygons);
+  auto slab_offsets = std::vector<uint64_t>{0};
+  auto slab_edges = std::vector<double>();
+  auto bands = std::vector<std::vector<uint64_t>>();
+  for (size_t ix = 0; ix < polygons; ++ix) {
+    const auto first = shorelines.offsets[ix];
+    const auto last = shorelines.offsets[ix + 1];
+    const auto& envelope = shorelines.envelopes[ix];
+    const auto y0 = envelope.min_corner().get<1>();
+    const auto height = envelope.max_corner().get<1>() - y0;
+    if (last - first < kSlabThreshold || !(height > 0)) {
+      continue;
+    }
+    const auto count = static_cast<uint64_t>(
+        std::ceil(std::sqrt(static_cast<double>(last - first - 1))));
+    auto& item = slabs[ix];
+    item = {y0, height / static_cast<double>(count), slab_offsets.size() - 1,
+            count};
+    auto band = [&item](const double lat) -> uint64_t {
+      const auto result = std::floor((lat - item.y0) / item.height);
+      return static_cast<uint64_t>(
+          std::clamp(result, 0.0, static_cast<double>(item.size - 1)));
+    };
+
+    bands.assign(count, {});
+    for (auto jx = first; jx + 1 < last; ++jx) {
+      const auto [min, max] = std::minmax(y[jx], y[jx + 1]);
+      if (min == max) {
+        continue;
+      }
+      for (auto kx = band(min); kx <= band(max); ++kx) {
+        bands[kx].push_back(jx);
+      }
+    }
+    for (const auto& edges : bands) {
+      for (const auto jx : edges) {
+        slab_edges.push_back(x[jx]);
+      }
+      for (const auto jx : edges) {
+        slab_edges.push_back(y[jx]);
+      }
+      for (const auto jx : edges) {
+        slab_edges.push_back(x[jx + 1]);
+      }
+      for (const auto jx : edges) {
+        slab_edges.push_back(y[jx + 1]);
+      }
+      slab_offsets.push_back(slab_offsets.back() + edges.size());
+    }
+  }
+
+  levels_ = Buffer<uint8_t>(std::move(shorelines.levels));
+  envelopes_ = Buffer<Box>(std::move(shorelines.envelopes));
+  offsets_ = Buffer<uint64_t>(std::move(shorelines.offsets));
+  ecef_ = Buffer<Cartesian>(std::move(ecef));
+  x_ = Buffer<double>(std::move(x));
+  y_ = Buffer<double>(std::move(y));
+  block_ranges_ = Buffer<std::array<double, 2>>(std::move(block_ranges));
+  slabs_ = Buffer<Slabs>(std::move(slabs));
+  slab_offsets_ = Buffer<uint64_t>(std::move(slab_offsets));
+  slab_edges_ = Buffer<double>(std::move(slab_edges));
+  parents_ = Buffer<uint32_t>(find_parents());
+}
+
+auto GSHHG::find_parents() const -> std::vector<uint32_t> {
+  auto result = std::vector<uint32_t>(levels_.size(), kRoot);
+  dispatch(
+      [&](const size_t start, const size_t end) {
+        auto candidates = std::vector<uint32_t>();
+        auto polygon = Polygon();
+        auto parent = Polygon();
+
+        // Gets the polygon of the given level containing the point.
+        auto find_parent = [&](const Point& point,
+                               const uint8_t level) -> uint32_t {
+          candidates.clear();
+          polygon_rtree_.query(
+              {point.get<0>(), point.get<1>()},
+              [&candidates](const uint32_t jx) { candidates.push_back(jx); });
+          for (const auto jx : candidates) {
+            if (levels_[jx] == level && contains(jx, point)) {
+              return jx;
+            }
+          }
+          return kRoot;
+        };
+
+        for (auto ix = start; ix < end; ++ix) {
+          const auto level = levels_[ix];
+          const auto first = offsets_[ix];
+          const auto size = offsets_[ix + 1] - first;
+          // Only the levels 2 to 4 (lakes, islands in lakes and ponds in
+          // islands) are nested in the previous level. The Antarctic ice
+          // front and grounding line, levels 5 and 6, overlap without being
+          // nested.
+          if (level < 2 || level > 4 || size == 0) {
+            continue;
+          }
+
+          // A point strictly inside the polygon is strictly inside its
+          // parent, even if both polygons share edges, e.g. those clipped by
+          // the bounding box: the parent is the only polygon of the previous
+          // level containing it.
+          const auto ring = this->ring(ix);
+          polygon.outer().assign(ring.begin(), ring.end());
+          auto interior = Point();
+          auto found = false;
+          try {
+            boost::geometry::point_on_surface(polygon, interior);
+            found = contains(ix, interior);
+          } catch (const boost::geometry::exception&) {
+          }
+          if (found) {
+            result[ix] = find_parent(interior, level - 1);
+            continue;
+          }
+
+          // Otherwise, e.g. for a polygon reduced to a sliver, the parent is
+          // the smallest polygon of the previous level covering it.
+          const auto& envelope = envelopes_[ix];
+          candidates.clear();
+          polygon_rtree_.query(
+              [&envelope](const PackedRTree<2>::Bounds& bounds) -> bool {
+                return bounds[0] <= envelope.min_corner().get<0>() &&
+                       bounds[2] >= envelope.max_corner().get<0>() &&
+                       bounds[1] <= envelope.min_corner().get<1>() &&
+                       bounds[3] >= envelope.max_corner().get<1>();
+              },
+              [&candidates](const uint32_t jx) { candidates.push_back(jx); });
+          auto smallest = std::numeric_limits<double>::max();
+          for (const auto jx : candidates) {
+            if (levels_[jx] + 1 != level) {
+              continue;
+            }
+            const auto other = this->ring(jx);
+            parent.outer().assign(other.begin(), other.end());
+            const auto area = boost::geometry::area(parent);
+            if (area < smallest &&
+                boost::geometry::covered_by(polygon, parent)) {
+              result[ix] = jx;
+              smallest = area;
+            }
+          }
+        }
+      },
+      levels_.size(), 0);
+  return result;
+}
+
+void GSHHG::build_grid(const double step) {
+  auto grid = MaskGrid(extent(), step);
+  const auto nx = grid.nx();
+
+  // List of the cells touched by the edges of each polygon: (cell, polygon)
+  // pairs.
+  auto crossings = std::vector<std::pair<size_t, uint32_t>>();
+  for (size_t ix = 0; ix < levels_.size(); ++ix) {
+    const auto ring = this->ring(ix);
+    const auto size = ring.size();
+    for (size_t jx = 0; jx < size; ++jx) {
+      const auto p0 = ring[jx];
+      const auto p1 = ring[(jx + 1) % size];
+      const auto [x0, x1] = grid.x_range(std::min(p0.get<0>(), p1.get<0>()),
+                                         std::max(p0.get<0>(), p1.get<0>()));
+      const auto [y0, y1] = grid.y_range(std::min(p0.get<1>(), p1.get<1>()),
+                                         std::max(p0.get<1>(), p1.get<1>()));
+      for (auto row = y0; row <= y1; ++row) {
+        for (auto col = x0; col <= x1; ++col) {
+          crossings.emplace_back(row * nx + col, static_cast<uint32_t>(ix));
+        }
+      }
+    }
+  }
+  std::sort(crossings.begin(), crossings.end());
+  crossings.erase(std::unique(crossings.begin(), crossings.end()),
+                  crossings.end());
+
+  auto it = crossings.begin();
+  auto candidates = std::vector<uint32_t>();
+  auto polygons = std::vector<uint32_t>();
+
+  // Last cell in which the position of each polygon has been evaluated and
+  // the result of this evaluation.
+  auto evaluated =
+      std::vector<size_t>(levels_.size(), std::numeric_limits<size_t>::max());
+  auto inside = std::vector<bool>(levels_.size(), false);
+
+  for (size_t iy = 0; iy < grid.ny(); ++iy) {
+    for (size_t ix = 0; ix < nx; ++ix) {
+      const auto cell = iy * nx + ix;
+      const auto box = grid.box(ix, iy);
+
+      // Polygons whose edges cross the current cell.
+      const auto first = it;
+      while (it != crossings.end() && it->first == cell) {
+        ++it;
+      }
+
+      // Polygons overlapping the cell, from the highest level to the lowest
+      candidates.clear();
+      polygon_rtree_.query(
+          [&box](const PackedRTree<2>::Bounds& bounds) -> bool {
+            return bounds[0] <= box.max_corner().get<0>() &&
+                   bounds[2] >= box.min_corner().get<0>() &&
+                   bounds[1] <= box.max_corner().get<1>() &&
+                   bounds[3] >= box.min_corner().get<1>();
+          },
+          [&candidates](const uint32_t ix) { candidates.push_back(ix); });
+      std::sort(candidates.begin(), candidates.end(), std::greater<>());
+
+      polygons.clear();
+      auto level = uint8_t(0);
+      for (const auto index : candidates) {
+        if (std::binary_search(first, it, std::make_pair(cell, index))) {
+          polygons.push_back(index);
+          continue;
+        }
+        // No edge of the polygon crosses the cell: the cell is either
+        // entirely inside or entirely outside the polygon. If no edge crosses
+        // the previous cell of the row either, both cells are in the same
+        // state.
+        if (ix == 0 || evaluated[index] != cell - 1) {
+          inside[index] =
+              contains(index, boost::geometry::return_centroid<Point>(box));
+        }
+        evaluated[index] = cell;
+        if (inside[index]) {
+          level = levels_[index];
+          break;
+        }
+      }
+      grid.push_back(cell, level, polygons);
+    }
+  }
+  grid_ = std::move(grid);
+}
+
 void GSHHG::load_shp(const std::string& filename, const uint8_t level,
-                     const bool patch, std::vector<Cartesian>& points) {
+                     const bool patch, Shorelines& shorelines) const {
   SHPHandle handle = SHPOpen(filename.c_str(), "rb");
   if (handle == nullptr) {
     throw std::system_error(ENOENT, std::system_category(), filename);
@@ -70,7 +486,14 @@ void GSHHG::load_shp(const std::string& filename, const uint8_t level,
   // Read file properties
   SHPGetInfo(handle, &entities, &shape_types, min_bound, max_bound);
 
-  // Skim over the list of shapes
+  // The shorelines being split at the antimeridian, the polygons clipped by
+  // both parts of a bounding box crossing it are stored as distinct
+  // polygons.
+  const auto boxes = bbox_ ? clip_boxes() : std::vector<Box>();
+  auto intersection = std::deque<Polygon>();
+
+  // Skim over the list of shapes: each polygon is stored, or clipped, as
+  // soon as it's read.
   for (int ix = 0; ix < entities; ++ix) {
     SHPObject* shape = SHPReadObject(handle, ix);
     if (shape == nullptr ||
@@ -105,28 +528,19 @@ void GSHHG::load_shp(const std::string& filename, const uint8_t level,
         boost::geometry::append(polygon, Point(0, -90));
       }
 
-      // Envelope of the current polygon
-      auto envelope = Box();
-
       // Is it necessary to make a geographical selection?
-      if (bbox_.has_value()) {
-        auto intersection = std::deque<Polygon>();
-        boost::geometry::intersection(polygon, bbox_.value(), intersection);
-        // If the read polygon is located in the geographical selection
-        if (!intersection.empty()) {
-          for (auto&& item : intersection) {
-            transform_polygon_points(item, points);
-            boost::geometry::envelope(item, envelope);
-            polygons_.emplace_back(
-                PolygonIndex{std::move(item), std::move(envelope), level});
-          }
-        }
+      if (!bbox_) {
+        shorelines.push_back(polygon, level);
       } else {
-        // We store the current polygon and its points
-        transform_polygon_points(polygon, points);
-        boost::geometry::envelope(polygon, envelope);
-        polygons_.emplace_back(
-            PolygonIndex{std::move(polygon), std::move(envelope), level});
+        // Only the parts of the polygon located in the geographical
+        // selection are stored.
+        intersection.clear();
+        for (const auto& box : boxes) {
+          boost::geometry::intersection(polygon, box, intersection);
+        }
+        for (const auto& item : intersection) {
+          shorelines.push_back(item, level);
+        }
       }
     }
     SHPDestroyObject(shape);
@@ -134,6 +548,420 @@ void GSHHG::load_shp(const std::string& filename, const uint8_t level,
   SHPClose(handle);
 }
 
+// Gets the Morton code of a point: the interleaved bits of its coordinates
+// quantized on 16 bits.
+static inline auto morton_code(const double lon, const double lat)
+    -> uint32_t {
+  auto quantize = [](const double value) -> uint32_t {
+    // This test also rejects the undefined coordinates.
+    if (!(value > 0)) {
+      return 0;
+    }
+    return static_cast<uint32_t>(std::min(value, 1.0) * 65535.0);
+  };
+  auto spread = [](uint32_t value) -> uint32_t {
+    value = (value | (value << 8U)) & 0x00FF00FFU;
+    value = (value | (value << 4U)) & 0x0F0F0F0FU;
+    value = (value | (value << 2U)) & 0x33333333U;
+    value = (value | (value << 1U)) & 0x55555555U;
+    return value;
+  };
+  return spread(quantize((normalize_angle(lon, -180.0, 360.0) + 180) / 360)) |
+         (spread(quantize((lat + 90) / 180)) << 1U);
+}
+
+void GSHHG::nearest_within(
+    const double* lon, const double* lat, const size_t size,
+    const double bound,
+    const std::function<void(size_t, double, double)>& consume) const {
+  // Points sorted in the Morton order
+  auto order = std::vector<std::pair<uint32_t, size_t>>(size);
+  for (size_t ix = 0; ix < size; ++ix) {
+    order[ix] = {morton_code(lon[ix], lat[ix]), ix};
+  }
+  std::sort(order.begin(), order.end());
+
+  // The coordinates are converted by blocks with the batch functions.
+  constexpr size_t kBlockSize = 256;
+  double x[kBlockSize], y[kBlockSize], z[kBlockSize];
+  double lon_block[kBlockSize], lat_block[kBlockSize];
+
+  auto hint = std::optional<uint32_t>();
+  for (size_t first = 0; first < size; first += kBlockSize) {
+    const auto block = std::min(kBlockSize, size - first);
+    for (size_t ix = 0; ix < block; ++ix) {
+      const auto index = order[first + ix].second;
+      lon_block[ix] = radians(lon[index]);
+      lat_block[ix] = radians(lat[index]);
+    }
+    geodetic_2_cartesian(lon_block, lat_block, block, x, y, z);
+    for (size_t ix = 0; ix < block; ++ix) {
+      const auto point = Cartesian(x[ix], y[ix], z[ix]);
+      const auto segment_ix = nearest_segment(point, hint, bound);
+      if (!segment_ix) {
+        x[ix] = y[ix] = z[ix] = std::numeric_limits<double>::quiet_NaN();
+        continue;
+      }
+      hint = segment_ix;
+      const auto closest = closest_point(point, segment(*hint));
+      x[ix] = closest.get<0>();
+      y[ix] = closest.get<1>();
+      z[ix] = closest.get<2>();
+    }
+    cartesian_2_geodetic(x, y, z, block, lon_block, lat_block);
+    for (size_t ix = 0; ix < block; ++ix) {
+      consume(order[first + ix].second, degrees(lon_block[ix]),
+              degrees(lat_block[ix]));
+    }
+  }
+}
+
+auto GSHHG::nearest(const double lon, const double lat, const size_t k,
+                    double* nearest_lon, double* nearest_lat) const -> size_t {
+  const auto point = geodetic_2_cartesian(geodetic_2_radian({lon, lat, 0}));
+
+  // Indices and distances of the segments found, reused by the following
+  // queries of the thread.
+  thread_local auto segments = std::vector<uint32_t>();
+  thread_local auto distances = std::vector<double>();
+
+  // The vertex shared by two segments is found twice: the search is
+  // extended until k distinct points are found.
+  for (auto size = k;; size *= 2) {
+    segments.resize(size);
+    distances.resize(size);
+    const auto count = rtree_.nearest(
+        {point.get<0>(), point.get<1>(), point.get<2>()},
+        [this, &point](const uint32_t ix) -> double {
+          return segment_distance(point, ix);
+        },
+        size, segments.data(), distances.data());
+
+    auto result = size_t(0);
+    for (size_t ix = 0; ix < count && result < k; ++ix) {
+      const auto closest = geodetic_2_degree(cartesian_2_geodetic(
+          closest_point(point, segment(segments[ix]))));
+      // The duplicates are at the same distance as the point kept.
+      auto duplicate = false;
+      for (auto jx = result; jx-- > 0 && distances[jx] == distances[ix];) {
+        if (nearest_lon[jx] == closest.get<0>() &&
+            nearest_lat[jx] == closest.get<1>()) {
+          duplicate = true;
+          break;
+        }
+      }
+      if (!duplicate) {
+        distances[result] = distances[ix];
+        nearest_lon[result] = closest.get<0>();
+        nearest_lat[result] = closest.get<1>();
+        ++result;
+      }
+    }
+    if (result == k || count < size) {
+      return result;
+    }
+  }
+}
+
+void GSHHG::rasterize_mask(const double lon0, const double lat0,
+                           const double dlon, const double dlat,
+                           const size_t nx, const size_t ny, uint8_t* mask,
+                           const size_t num_threads) const {
+  if (!(dlon > 0) || !(dlat > 0)) {
+    throw std::invalid_argument("the grid steps must be strictly positive");
+  }
+  std::fill(mask, mask + nx * ny, 0);
+  if (nx == 0) {
+    return;
+  }
+
+  // The rows are processed by blocks: the edges of the polygons overlapping
+  // a block are read once for all its rows.
+  constexpr size_t kBlockSize = 64;
+  const auto lon1 = lon0 + static_cast<double>(nx - 1) * dlon;
+  auto latitude = [lat0, dlat](const size_t iy) -> double {
+    return lat0 + static_cast<double>(iy) * dlat;
+  };
+
+  dispatch(
+      [&](const size_t start, const size_t end) {
+        auto candidates = std::vector<uint32_t>();
+        // Crossings of the edges of a polygon with the rows of the block:
+        // (row, longitude)
+        auto crossings = std::vector<std::pair<size_t, double>>();
+
+        for (auto first = start * kBlockSize;
+             first < std::min(end * kBlockSize, ny); first += kBlockSize) {
+          const auto last = std::min(first + kBlockSize, ny);
+          const auto y0 = latitude(first);
+          const auto y1 = latitude(last - 1);
+
+          candidates.clear();
+          polygon_rtree_.query(
+              [y0, y1](const PackedRTree<2>::Bounds& bounds) -> bool {
+                return bounds[1] <= y1 && bounds[3] >= y0;
+              },
+              [&candidates](const uint32_t ix) { candidates.push_back(ix); });
+          // The polygons of the highest levels, loaded last, are painted
+          // last.
+          std::sort(candidates.begin(), candidates.end());
+
+          for (const auto index : candidates) {
+            const auto ring = this->ring(index);
+            const auto size = ring.size();
+            crossings.clear();
+            for (size_t jx = 0; jx < size; ++jx) {
+              const auto p0 = ring[jx];
+              const auto p1 = ring[(jx + 1) % size];
+              const auto ya = p0.get<1>();
+              const auto yb = p1.get<1>();
+              if (std::max(ya, yb) < y0 || std::min(ya, yb) > y1 ||
+                  ya == yb) {
+                continue;
+              }
+              // Rows whose latitude y satisfies min(ya, yb) <= y <
+              // max(ya, yb), a row crossing a vertex being counted once.
+              const auto low = std::min(ya, yb);
+              const auto high = std::max(ya, yb);
+              auto iy = static_cast<size_t>(
+                  std::max(std::ceil((low - lat0) / dlat) - 1,
+                           static_cast<double>(first)));
+              for (; iy < last; ++iy) {
+                const auto y = latitude(iy);
+                if (y >= high) {
+                  break;
+                }
+                if (y >= low) {
+                  crossings.emplace_back(
+                      iy, p0.get<0>() + (y - ya) * (p1.get<0>() - p0.get<0>()) /
+                                            (yb - ya));
+                }
+              }
+            }
+            std::sort(crossings.begin(), crossings.end());
+
+            // The points between two consecutive crossings of a row are
+            // alternately inside and outside the polygon.
+            const auto level = levels_[index];
+            for (size_t jx = 0; jx + 1 < crossings.size(); jx += 2) {
+              const auto iy = crossings[jx].first;
+              const auto xa = crossings[jx].second;
+              const auto xb = crossings[jx + 1].second;
+              auto* row = mask + iy * nx;
+              // The grid may cover the polygon several times, modulo 360
+              // degrees.
+              const auto kmin = std::floor((lon0 - xb) / 360);
+              const auto kmax = std::ceil((lon1 - xa) / 360);
+              for (auto k = kmin; k <= kmax; ++k) {
+                const auto shift = k * 360 - lon0;
+                const auto ia = std::max(std::ceil((xa + shift) / dlon), 0.0);
+                const auto ib = std::min(std::ceil((xb + shift) / dlon),
+                                         static_cast<double>(nx));
+                if (ia < ib) {
+                  std::fill(row + static_cast<size_t>(ia),
+                            row + static_cast<size_t>(ib), level);
+                }
+              }
+            }
+          }
+        }
+      },
+      (ny + kBlockSize - 1) / kBlockSize, num_threads);
+}
+
+auto GSHHG::grid_nearest_segments(const double lon0, const double lat0,
+                                  const double dlon, const double dlat,
+                                  const size_t nx, const size_t ny,
+                                  const bool exact,
+                                  const size_t num_threads) const
+    -> std::vector<uint32_t> {
+  if (!(dlon > 0) || !(dlat > 0)) {
+    throw std::invalid_argument("the grid steps must be strictly positive");
+  }
+  if (ecef_.empty()) {
+    throw std::out_of_range("no coastline segment loaded");
+  }
+  constexpr auto kNone = std::numeric_limits<uint32_t>::max();
+  const auto size = nx * ny;
+  if (size == 0) {
+    return {};
+  }
+
+  // A grid covering all the longitudes is periodic along the x-axis.
+  const auto periodic = static_cast<double>(nx) * dlon >= 360 - 1e-9;
+
+  // The ECEF coordinates of a grid point are the product of a function of
+  // its longitude by a function of its latitude.
+  auto columns = std::vector<std::pair<double, double>>(nx);
+  for (size_t ix = 0; ix < nx; ++ix) {
+    const auto lon = radians(lon0 + static_cast<double>(ix) * dlon);
+    columns[ix] = {std::cos(lon), std::sin(lon)};
+  }
+  auto rows = std::vector<Cartesian>(ny);
+  for (size_t iy = 0; iy < ny; ++iy) {
+    rows[iy] = geodetic_2_cartesian(
+        geodetic_2_radian({0, lat0 + static_cast<double>(iy) * dlat, 0}));
+  }
+  auto point = [&](const size_t ix, const size_t iy) -> Cartesian {
+    const auto& row = rows[iy];
+    return {row.get<0>() * columns[ix].first,
+            row.get<0>() * columns[ix].second, row.get<2>()};
+  };
+
+  // Nearest segment found for each point of the grid and its comparable
+  // distance.
+  auto segments = std::vector<uint32_t>(size, kNone);
+  auto distances = std::vector<double>(size);
+  auto seed = [&](const size_t ix, const size_t iy, const uint32_t item) {
+    const auto cell = iy * nx + ix;
+    const auto distance = segment_distance(point(ix, iy), item);
+    if (segments[cell] == kNone || distance < distances[cell]) {
+      segments[cell] = item;
+      distances[cell] = distance;
+    }
+  };
+
+  // The segments are the seeds of the grid points they pass through: each
+  // segment is sampled at the resolution of the grid.
+  for (size_t ix = 0; ix < levels_.size(); ++ix) {
+    for (auto jx = offsets_[ix]; jx + 1 < offsets_[ix + 1]; ++jx) {
+      const auto first = Point(x_[jx], y_[jx]);
+      const auto second = Point(x_[jx + 1], y_[jx + 1]);
+      const auto x0 =
+          (normalize_angle(first.get<0>(), lon0, 360.0) - lon0) / dlon;
+      const auto y0 = (first.get<1>() - lat0) / dlat;
+      auto dx = (second.get<0>() - first.get<0>()) / dlon;
+      const auto dy = (second.get<1>() - first.get<1>()) / dlat;
+      // A segment crossing the antimeridian is only seeded by its ends.
+      const auto crossing = std::fabs(dx * dlon) > 180;
+      const auto samples = crossing ? size_t(1)
+                                    : static_cast<size_t>(std::ceil(
+                                          std::max(std::fabs(dx),
+                                                   std::fabs(dy))));
+      for (size_t kx = 0; kx <= samples; ++kx) {
+        const auto t = static_cast<double>(kx) / static_cast<double>(samples);
+        auto x = std::round(x0 + t * dx);
+        const auto y = std::round(y0 + t * dy);
+        if (crossing && kx == samples) {
+          x = std::round(
+              (normalize_angle(second.get<0>(), lon0, 360.0) - lon0) / dlon);
+        }
+        if (periodic) {
+          x = normalize_angle(x, 0.0, static_cast<double>(nx));
+        }
+        if (x >= 0 && y >= 0 && x < static_cast<double>(nx) &&
+            y < static_cast<double>(ny)) {
+          seed(static_cast<size_t>(x), static_cast<size_t>(y),
+               static_cast<uint32_t>(jx));
+        }
+      }
+    }
+  }
+
+  // The nearest segments of the points on the edges of the grid are searched
+  // in the R-tree: they propagate the coastlines outside the grid.
+  auto edges = std::vector<std::pair<size_t, size_t>>();
+  for (size_t ix = 0; ix < nx; ++ix) {
+    edges.emplace_back(ix, 0);
+    edges.emplace_back(ix, ny - 1);
+  }
+  for (size_t iy = 0; !periodic && iy < ny; ++iy) {
+    edges.emplace_back(0, iy);
+    edges.emplace_back(nx - 1, iy);
+  }
+  for (const auto& item : edges) {
+    seed(item.first, item.second,
+         nearest_segment(point(item.first, item.second)));
+  }
+
+  // Jump flooding: each point takes the segment of its neighbors, at a
+  // decreasing distance, nearer than its own. A last pass with a step of one
+  // point corrects most of the errors of the algorithm.
+  auto steps = std::vector<int64_t>();
+  for (auto step = std::max(nx, ny) / 2; step > 0; step /= 2) {
+    steps.push_back(static_cast<int64_t>(step));
+  }
+  steps.push_back(1);
+
+  const auto width = static_cast<int64_t>(nx);
+  const auto height = static_cast<int64_t>(ny);
+  auto next_segments = std::vector<uint32_t>(size);
+  auto next_distances = std::vector<double>(size);
+  for (const auto step : steps) {
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          for (auto iy = start; iy < end; ++iy) {
+            for (size_t ix = 0; ix < nx; ++ix) {
+              const auto cell = iy * nx + ix;
+              auto segment = segments[cell];
+              auto distance = distances[cell];
+              auto candidates = std::array<uint32_t, 8>();
+              auto count = size_t(0);
+              for (const auto dy : {-step, int64_t(0), step}) {
+                const auto y = static_cast<int64_t>(iy) + dy;
+                if (y < 0 || y >= height) {
+                  continue;
+                }
+                for (const auto dx : {-step, int64_t(0), step}) {
+                  auto x = static_cast<int64_t>(ix) + dx;
+                  if (periodic) {
+                    x = (x % width + width) % width;
+                  } else if (x < 0 || x >= width) {
+                    continue;
+                  }
+                  const auto item =
+                      segments[static_cast<size_t>(y * width + x)];
+                  if (item == kNone || item == segment ||
+                      std::find(candidates.begin(),
+                                candidates.begin() + count,
+                                item) != candidates.begin() + count) {
+                    continue;
+                  }
+                  candidates[count++] = item;
+                }
+              }
+              if (count != 0) {
+                const auto current = point(ix, iy);
+                for (size_t kx = 0; kx < count; ++kx) {
+                  const auto candidate =
+                      segment_distance(current, candidates[kx]);
+                  if (segment == kNone || candidate < distance) {
+                    segment = candidates[kx];
+                    distance = candidate;
+                  }
+                }
+              }
+              next_segments[cell] = segment;
+              next_distances[cell] = distance;
+            }
+          }
+        },
+        ny, num_threads);
+    std::swap(segments, next_segments);
+    std::swap(distances, next_distances);
+  }
+
+  // If the result must be exact, the nearest segment of each point is
+  // searched in the R-tree, the segment found bounding the search.
+  if (exact) {
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          for (auto iy = start; iy < end; ++iy) {
+            const auto lat = lat0 + static_cast<double>(iy) * dlat;
+            for (size_t ix = 0; ix < nx; ++ix) {
+              const auto lon = lon0 + static_cast<double>(ix) * dlon;
+              auto& item = segments[iy * nx + ix];
+              item = nearest_segment(
+                  geodetic_2_cartesian(geodetic_2_radian({lon, lat, 0})),
+                  item);
+            }
+          }
+        },
+        ny, num_threads);
+  }
+  return segments;
+}
+
 void GSHHG::to_svg(const std::string& filename, const int width,
                    const int height) const {
   std::ofstream svg;
@@ -141,17 +969,18 @@ void GSHHG::to_svg(const std::string& filename, const int width,
   svg.open(filename.c_str());
 
   boost::geometry::svg_mapper<Point> mapper(svg, width, height);
-  mapper.add(bbox_.value_or(Box({-180, -90}, {180, 90})));
+  mapper.add(extent());
 
   unsigned int index = 0;
 
-  for (const auto& item : boost::adaptors::reverse(polygons_)) {
+  for (auto ix = polygons(); ix-- > 0;) {
+    const auto item = ring(ix);
     auto rgb = (++index) % 0x1000000U;
     auto code = std::to_string((rgb >> 16U) & 0xFFU) + "," +
                 std::to_string((rgb >> 8U) & 0xFFU) + "," +
                 std::to_string(rgb & 0xFFU);
-    mapper.add(item.polygon);
-    mapper.map(item.polygon, "fill-opacity:0.5;fill:rgb(" + code +
+    mapper.add(item);
+    mapper.map(item, "fill-opacity:0.5;fill:rgb(" + code +
                                  ");stroke:rgb(" + code + ");" +
                                  "stroke-width:0.2");
   }
@@ -1,12 +1,23 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <boost/container/small_vector.hpp>
+#include <cmath>
 #include <filesystem>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include "buffer.hpp"
 #include "geometry.hpp"
+#include "grid.hpp"
+#include "mapped_file.hpp"
+#include "rtree.hpp"
+#include "thread.hpp"
 
 namespace gshhg {
 
@@ -21,18 +32,41 @@ class GSHHG {
     kFull = 'f'
   };
 
+  // Levels counted as land by the signed distances: the level n is land if
+  // the bit of rank n is set. By default, all the levels are land.
+  static constexpr uint8_t kLand = 0x7E;
+
+  // Gets the set of levels counted as land from their list. Throws
+  // std::invalid_argument if a level isn't between 1 and 6.
+  static auto land_levels(const std::vector<int>& levels) -> uint8_t;
+
   // Default constructor
+  //
+  // If grid_step is set, an acceleration grid of the given step, in degrees,
+  // is built to speed up the mask calculation.
+  //
+  // If cache is set, it defines the directory storing the binary cache files
+  // of the loaded shorelines. If a cache file matching the resolution, the
+  // levels and the bounding box requested exists, it's mapped in memory and
+  // queried in place instead of reading the shapefiles: all the processes
+  // using this file share a single copy of the shorelines. Otherwise, it's
+  // created once the shapefiles have been read, unless the directory can't
+  // be written.
   GSHHG(const std::string& dirname,
         const std::optional<std::string>& resolution,
         const std::optional<std::vector<int>>& levels,
-        std::optional<Box> bbox);
+        std::optional<Box> bbox,
+        const std::optional<double>& grid_step = std::nullopt,
+        const std::optional<std::string>& cache = std::nullopt);
 
   // Gets the number of points handled
-  [[nodiscard]] inline auto points() const -> size_t { return rtree_->size(); }
+  [[nodiscard]] inline auto points() const -> size_t {
+    return offsets_.empty() ? 0 : offsets_.back();
+  }
 
   // Gets the number of polygon handled
   [[nodiscard]] inline auto polygons() const -> size_t {
-    return polygons_.size();
+    return levels_.size();
   }
 
   // Gets the level of the polygon in which the given point is located or zero
@@ -41,13 +75,47 @@ class GSHHG {
       -> uint8_t {
     auto point = Point(normalize_angle(lon, -180.0, 360.0), lat);
 
-    for (const auto& item : boost::adaptors::reverse(polygons_)) {
-      if (boost::geometry::intersects(point, item.envelope) &&
-          boost::geometry::intersects(point, item.polygon)) {
-        return item.level;
+    // If the acceleration grid is available, only the polygons crossing the
+    // cell containing the point are tested.
+    if (grid_) {
+      const auto cell = grid_->cell(point);
+      if (!cell) {
+        return 0;
+      }
+      for (const auto ix : grid_->polygons(*cell)) {
+        if (boost::geometry::intersects(point, envelopes_[ix]) &&
+            contains(ix, point)) {
+          return levels_[ix];
+        }
       }
+      return grid_->level(*cell);
     }
-    return 0;
+
+    // Polygons whose envelope contains the point.
+    auto candidates = boost::container::small_vector<uint32_t, 16>();
+    polygon_rtree_.query(
+        {point.get<0>(), point.get<1>()},
+        [&candidates](const uint32_t ix) { candidates.push_back(ix); });
+
+    // The polygons are nested: the containment tree is descended from its
+    // roots, only the children of the last polygon containing the point being
+    // tested. Among overlapping siblings, the last polygons loaded, those of
+    // the highest levels, are tested first.
+    std::sort(candidates.begin(), candidates.end(), std::greater<>());
+    auto parent = kRoot;
+    auto level = uint8_t(0);
+    for (auto found = true; found;) {
+      found = false;
+      for (const auto ix : candidates) {
+        if (parents_[ix] == parent && contains(ix, point)) {
+          parent = ix;
+          level = levels_[ix];
+          found = true;
+          break;
+        }
+      }
+    }
+    return level;
   }
 
   // Gets the nearest point of one of the handled polygons.
@@ -57,13 +125,205 @@ class GSHHG {
     return geodetic_2_degree(cartesian_2_geodetic(nearest(ecef)));
   }
 
-  // Gets the distance of the nearest point
+  // Gets the distance of the nearest point. If max_distance, in meters, is
+  // set, only the coastlines located within this distance are searched: the
+  // distance returned is capped at max_distance.
   template <class Strategy>
   [[nodiscard]] inline auto distance_to_nearest(
-      const double lon, const double lat, const Strategy& strategy) const
+      const double lon, const double lat, const Strategy& strategy,
+      const double max_distance = std::numeric_limits<double>::infinity())
+      const -> double {
+    const auto distance = bounded_distance(lon, lat, strategy, max_distance);
+    return distance ? std::min(*distance, max_distance) : max_distance;
+  }
+
+  // Tests if the nearest point is located within the given distance, in
+  // meters. The coastlines farther than this distance are not searched.
+  template <class Strategy>
+  [[nodiscard]] inline auto within_distance(const double lon, const double lat,
+                                            const double radius,
+                                            const Strategy& strategy) const
+      -> bool {
+    const auto distance = bounded_distance(lon, lat, strategy, radius);
+    return distance && *distance <= radius;
+  }
+
+  // Gets the nearest points of the handled polygons for arrays of points.
+  //
+  // The points are processed in the Morton order of their coordinates: the
+  // search of each point is pruned by the coastline segment found for the
+  // previous one. No memory is allocated per point.
+  void nearest(const double* lon, const double* lat, const size_t size,
+               double* nearest_lon, double* nearest_lat) const {
+    nearest_within(lon, lat, size, std::numeric_limits<double>::infinity(),
+                   nearest_lon, nearest_lat);
+  }
+
+  // Gets the k nearest distinct points of the handled polygons, sorted by
+  // increasing distance: a vertex nearest to the point through its two
+  // segments is returned once. The points are written into buffers of at
+  // least k elements. Returns the number of points found.
+  auto nearest(double lon, double lat, size_t k, double* nearest_lon,
+               double* nearest_lat) const -> size_t;
+
+  // Gets the distances of the nearest points for arrays of points, capped at
+  // max_distance. The geodesic distance is only computed for the points
+  // having a coastline within max_distance.
+  template <class Strategy>
+  void distance_to_nearest(
+      const double* lon, const double* lat, const size_t size,
+      const Strategy& strategy, double* distance,
+      const double max_distance = std::numeric_limits<double>::infinity())
+      const {
+    auto nearest_lon = std::vector<double>(size);
+    auto nearest_lat = std::vector<double>(size);
+    nearest_within(lon, lat, size, chord_bound(max_distance),
+                   nearest_lon.data(), nearest_lat.data());
+    for (size_t ix = 0; ix < size; ++ix) {
+      distance[ix] =
+          std::isnan(nearest_lon[ix])
+              ? max_distance
+              : std::min(boost::geometry::distance(
+                             GeodeticDegree{nearest_lon[ix], nearest_lat[ix]},
+                             GeodeticDegree{lon[ix], lat[ix]}, strategy),
+                         max_distance);
+    }
+  }
+
+  // Tests if the nearest points are located within the given distance for
+  // arrays of points.
+  template <class Strategy>
+  void within_distance(const double* lon, const double* lat,
+                       const size_t size, const double radius,
+                       const Strategy& strategy, bool* result) const {
+    auto nearest_lon = std::vector<double>(size);
+    auto nearest_lat = std::vector<double>(size);
+    nearest_within(lon, lat, size, chord_bound(radius), nearest_lon.data(),
+                   nearest_lat.data());
+    for (size_t ix = 0; ix < size; ++ix) {
+      result[ix] = !std::isnan(nearest_lon[ix]) &&
+                   boost::geometry::distance(
+                       GeodeticDegree{nearest_lon[ix], nearest_lat[ix]},
+                       GeodeticDegree{lon[ix], lat[ix]}, strategy) <= radius;
+    }
+  }
+
+  // Gets, for arrays of points, the mask value, the nearest point and its
+  // distance in a single pass over the points: they are processed in the
+  // Morton order, the mask and the distance of each point being computed as
+  // soon as its nearest point is found.
+  template <class Strategy>
+  void classify(const double* lon, const double* lat, const size_t size,
+                const Strategy& strategy, uint8_t* level, double* nearest_lon,
+                double* nearest_lat, double* distance) const {
+    nearest_within(
+        lon, lat, size, std::numeric_limits<double>::infinity(),
+        [&](const size_t ix, const double x, const double y) {
+          nearest_lon[ix] = x;
+          nearest_lat[ix] = y;
+          level[ix] = mask(lon[ix], lat[ix]);
+          distance[ix] = boost::geometry::distance(
+              GeodeticDegree{x, y}, GeodeticDegree{lon[ix], lat[ix]},
+              strategy);
+        });
+  }
+
+  // Gets the distance of the nearest point, negative if the point is located
+  // on land, that is in a polygon whose level belongs to the set land, and
+  // positive at sea.
+  template <class Strategy>
+  [[nodiscard]] inline auto signed_distance(const double lon, const double lat,
+                                            const Strategy& strategy,
+                                            const uint8_t land = kLand) const
       -> double {
-    return boost::geometry::distance(nearest(lon, lat),
-                                     GeodeticDegree{lon, lat}, strategy);
+    const auto distance = distance_to_nearest(lon, lat, strategy);
+    return is_land(mask(lon, lat), land) ? -distance : distance;
+  }
+
+  // Gets the signed distances of the nearest points for arrays of points in
+  // a single pass over the points, as classify does: the mask of each point
+  // is computed as soon as its nearest point is found.
+  template <class Strategy>
+  void signed_distance(const double* lon, const double* lat,
+                       const size_t size, const Strategy& strategy,
+                       const uint8_t land, double* distance) const {
+    nearest_within(
+        lon, lat, size, std::numeric_limits<double>::infinity(),
+        [&](const size_t ix, const double x, const double y) {
+          const auto value =
+              std::isnan(x) ? std::numeric_limits<double>::infinity()
+                            : boost::geometry::distance(
+                                  GeodeticDegree{x, y},
+                                  GeodeticDegree{lon[ix], lat[ix]}, strategy);
+          distance[ix] =
+              is_land(mask(lon[ix], lat[ix]), land) ? -value : value;
+        });
+  }
+
+  // Calculates the land/sea mask on the points of a regular grid: the value
+  // of the point (lon0 + ix * dlon, lat0 + iy * dlat) is stored in
+  // mask[iy * nx + ix]. The rows of the grid are filled from the crossings of
+  // the polygon edges, the polygons being painted from the lowest level to
+  // the highest. num_threads is the number of threads to use, 0 for all the
+  // CPUs.
+  void rasterize_mask(double lon0, double lat0, double dlon, double dlat,
+                      size_t nx, size_t ny, uint8_t* mask,
+                      size_t num_threads = 0) const;
+
+  // Calculates the distances to the nearest points of the handled polygons
+  // on the points of a regular grid, stored like the values of
+  // rasterize_mask. The nearest coastline segments of the points are
+  // propagated over the grid from the segment ends by a jump flooding
+  // algorithm. If exact is true, the segment found for each point bounds an
+  // exact search of its nearest segment, otherwise, the distances are
+  // approximate.
+  template <class Strategy>
+  void rasterize_distance_to_nearest(const double lon0, const double lat0,
+                                     const double dlon, const double dlat,
+                                     const size_t nx, const size_t ny,
+                                     const Strategy& strategy,
+                                     const bool exact, double* distance,
+                                     const size_t num_threads = 0) const {
+    const auto segments = grid_nearest_segments(lon0, lat0, dlon, dlat, nx,
+                                                 ny, exact, num_threads);
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          for (auto iy = start; iy < end; ++iy) {
+            const auto lat = lat0 + static_cast<double>(iy) * dlat;
+            for (size_t ix = 0; ix < nx; ++ix) {
+              const auto lon = lon0 + static_cast<double>(ix) * dlon;
+              const auto point =
+                  geodetic_2_cartesian(geodetic_2_radian({lon, lat, 0}));
+              const auto nearest = geodetic_2_degree(cartesian_2_geodetic(
+                  closest_point(point, segment(segments[iy * nx + ix]))));
+              distance[iy * nx + ix] = boost::geometry::distance(
+                  nearest, GeodeticDegree{lon, lat}, strategy);
+            }
+          }
+        },
+        ny, num_threads);
+  }
+
+  // Calculates the signed distances on the points of a regular grid, stored
+  // like the values of rasterize_mask: the distances of
+  // rasterize_distance_to_nearest are negated on the land of the grid
+  // calculated by rasterize_mask.
+  template <class Strategy>
+  void rasterize_signed_distance(const double lon0, const double lat0,
+                                 const double dlon, const double dlat,
+                                 const size_t nx, const size_t ny,
+                                 const Strategy& strategy, const uint8_t land,
+                                 const bool exact, double* distance,
+                                 const size_t num_threads = 0) const {
+    rasterize_distance_to_nearest(lon0, lat0, dlon, dlat, nx, ny, strategy,
+                                  exact, distance, num_threads);
+    auto mask = std::vector<uint8_t>(nx * ny);
+    rasterize_mask(lon0, lat0, dlon, dlat, nx, ny, mask.data(), num_threads);
+    for (size_t ix = 0; ix < nx * ny; ++ix) {
+      if (is_land(mask[ix], land)) {
+        distance[ix] = -distance[ix];
+      }
+    }
   }
 
   // Create the SVG figure of the handled polygons.
@@ -71,11 +331,50 @@ class GSHHG {
               const int height) const -> void;
 
  private:
-  // Structure indexing the loaded polygons.
-  struct PolygonIndex {
-    Polygon polygon;
-    Box envelope;
-    uint8_t level;
+  // Gives the tests of the C++ library access to the internal structures.
+  friend struct GSHHGInternals;
+
+  // Number of edges of the blocks whose latitudes are bounded, to skip them
+  // in the point-in-polygon tests.
+  static constexpr uint64_t kEdgeBlock = 32;
+
+  // Parent of the polygons that are not nested in another polygon
+  static constexpr uint32_t kRoot = std::numeric_limits<uint32_t>::max();
+
+  // Minimum number of points of the polygons whose edges are distributed in
+  // latitude bands.
+  static constexpr uint64_t kSlabThreshold = 1024;
+
+  // Latitude bands of equal height covering a polygon, each one holding the
+  // edges crossing it.
+  struct Slabs {
+    // Latitude of the bottom of the first band and height of the bands
+    double y0;
+    double height;
+    // Index of the first band in slab_offsets_ and number of bands, zero if
+    // the edges of the polygon aren't distributed in bands.
+    uint64_t first;
+    uint64_t size;
+  };
+
+  // Tests if a mask value belongs to the set of land levels
+  static constexpr auto is_land(const uint8_t level, const uint8_t land)
+      -> bool {
+    return level != 0 && ((land >> level) & 1U) != 0;
+  }
+
+  // Polygons read from the shapefiles, before being indexed.
+  struct Shorelines {
+    std::vector<uint8_t> levels{};
+    std::vector<Box> envelopes{};
+    std::vector<uint64_t> offsets{0};
+    std::vector<Point> points{};
+
+    // Append the outer ring of a polygon
+    void push_back(const Polygon& polygon, uint8_t level);
+
+    // Append the polygons of another instance
+    void extend(const Shorelines& other);
   };
 
   // Parse the resolution string
@@ -99,27 +398,286 @@ class GSHHG {
                                 "' is not defined");
   }
 
+  // Tests if the bounding box crosses the antimeridian: its western
+  // longitude is then greater than its eastern one.
+  [[nodiscard]] inline auto crosses_antimeridian() const -> bool {
+    return bbox_ && bbox_->min_corner().get<0>() > bbox_->max_corner().get<0>();
+  }
+
+  // Gets the boxes clipping the polygons loaded: a bounding box crossing the
+  // antimeridian is split into its eastern and western parts.
+  [[nodiscard]] inline auto clip_boxes() const -> std::vector<Box> {
+    const auto& min_corner = bbox_->min_corner();
+    const auto& max_corner = bbox_->max_corner();
+    if (!crosses_antimeridian()) {
+      return {*bbox_};
+    }
+    return {Box(min_corner, {180, max_corner.get<1>()}),
+            Box({-180, min_corner.get<1>()}, max_corner)};
+  }
+
+  // Gets the area covered by the polygons loaded. If the bounding box crosses
+  // the antimeridian, it covers all the longitudes of its latitudes.
+  [[nodiscard]] inline auto extent() const -> Box {
+    if (!bbox_) {
+      return {{-180, -90}, {180, 90}};
+    }
+    if (crosses_antimeridian()) {
+      return {{-180, bbox_->min_corner().get<1>()},
+              {180, bbox_->max_corner().get<1>()}};
+    }
+    return *bbox_;
+  }
+
   // Load the shapefile selected
   void load_shp(const std::string& filename, uint8_t level, bool patch,
-                std::vector<Cartesian>& points);
+                Shorelines& shorelines) const;
+
+  // Store the polygons read and build their spatial indexes
+  void index(Shorelines&& shorelines);
+
+  // Gets the parent of each indexed polygon in the containment tree: the
+  // polygon of the previous level containing it, or kRoot.
+  [[nodiscard]] auto find_parents() const -> std::vector<uint32_t>;
+
+  // Build the acceleration grid of the mask
+  void build_grid(double step);
+
+  // Build the key identifying the cache file of the loaded shorelines
+  [[nodiscard]] auto cache_key(
+      Resolution resolution,
+      const std::vector<std::pair<std::filesystem::path, uint8_t>>& shapefiles)
+      const -> std::string;
+
+  // Build the path to the cache file identified by the given key
+  [[nodiscard]] static auto cache_path(const std::string& dirname,
+                                       const std::string& resolution,
+                                       const std::string& key)
+      -> std::filesystem::path;
+
+  // Map the cache file and query the shorelines in place. Returns false if
+  // the file does not exist, doesn't match the key or is inconsistent: the
+  // shapefiles are then read and the file rewritten.
+  auto read_cache(const std::filesystem::path& path, const std::string& key)
+      -> bool;
 
+  // Write the shorelines and their spatial indexes into the cache file.
+  void write_cache(const std::filesystem::path& path,
+                   const std::string& key) const;
+
+  // Gets the outer ring of a polygon
+  [[nodiscard]] inline auto ring(const size_t ix) const -> RingView {
+    return {x_.data() + offsets_[ix], y_.data() + offsets_[ix],
+            offsets_[ix + 1] - offsets_[ix]};
+  }
+
+  // Tests if a point is inside the outer ring of a polygon. For the largest
+  // polygons, only the edges of the latitude band of the point are tested.
+  // Otherwise, the edges of the ring are tested by blocks.
+  [[nodiscard]] inline auto contains(const size_t ix, const Point& point) const
+      -> bool {
+    return slabs_[ix].size != 0 ? contains_slab(ix, point)
+                                : contains_blocks(ix, point);
+  }
+
+  // Tests if a point is inside the outer ring of a polygon distributed in
+  // latitude bands: only the edges of the band of the point are tested.
+  [[nodiscard]] inline auto contains_slab(const size_t ix,
+                                          const Point& point) const -> bool {
+    const auto px = point.get<0>();
+    const auto py = point.get<1>();
+    const auto& slabs = slabs_[ix];
+    const auto band = std::floor((py - slabs.y0) / slabs.height);
+    if (!(band >= 0 && band < static_cast<double>(slabs.size))) {
+      return false;
+    }
+    const auto slab = slabs.first + static_cast<uint64_t>(band);
+    const auto first = slab_offsets_[slab];
+    const auto size = slab_offsets_[slab + 1] - first;
+    const auto* x0 = slab_edges_.data() + 4 * first;
+    return odd_crossings(x0, x0 + size, x0 + 2 * size, x0 + 3 * size, size, px,
+                         py);
+  }
+
+  // Tests if a point is inside the outer ring of a polygon by processing its
+  // edges by blocks of kEdgeBlock edges, the blocks whose latitudes don't
+  // include the point being skipped.
+  [[nodiscard]] inline auto contains_blocks(const size_t ix,
+                                            const Point& point) const
+      -> bool {
+    const auto px = point.get<0>();
+    const auto py = point.get<1>();
+    const auto last = offsets_[ix + 1];
+    auto result = false;
+    for (auto first = offsets_[ix]; first + 1 < last;) {
+      const auto block = first / kEdgeBlock;
+      const auto end = std::min<uint64_t>((block + 1) * kEdgeBlock, last - 1);
+      const auto& range = block_ranges_[block];
+      if (range[0] <= py && py <= range[1]) {
+        result ^= odd_crossings(x_.data() + first, y_.data() + first,
+                                end - first, px, py);
+      }
+      first = end;
+    }
+    return result;
+  }
+
+  // Gets the coastline segment joining the point ix to the next point of its
+  // ring.
+  [[nodiscard]] inline auto segment(const size_t ix) const
+      -> CartesianSegment {
+    return {ecef_[ix], ecef_[ix + 1]};
+  }
+
+  // Gets the comparable distance between a point and a coastline segment
+  [[nodiscard]] inline auto segment_distance(const Cartesian& point,
+                                             const uint32_t ix) const
+      -> double {
+    return boost::geometry::comparable_distance(
+        point, closest_point(point, segment(ix)));
+  }
+
+  // Gets the nearest coastline segment of the given point. The hint is a
+  // segment assumed to be close to the point.
+  [[nodiscard]] inline auto nearest_segment(
+      const Cartesian& point, const std::optional<uint32_t>& hint = {}) const
+      -> uint32_t {
+    return *nearest_segment(point, hint,
+                            std::numeric_limits<double>::infinity());
+  }
+
+  // Gets the nearest coastline segment of the given point whose comparable
+  // distance to the point doesn't exceed bound, if any.
+  [[nodiscard]] inline auto nearest_segment(const Cartesian& point,
+                                            const std::optional<uint32_t>& hint,
+                                            const double bound) const
+      -> std::optional<uint32_t> {
+    const auto result = rtree_.nearest(
+        {point.get<0>(), point.get<1>(), point.get<2>()},
+        [this, &point](const uint32_t ix) -> double {
+          return segment_distance(point, ix);
+        },
+        hint, bound);
+    if (!result) {
+      if (std::isinf(bound)) {
+        throw std::out_of_range("no coastline segment loaded");
+      }
+      return {};
+    }
+    return result->first;
+  }
+
+  // Gets the comparable distance, in ECEF, beyond which the coastline
+  // segments are farther than max_distance meters from a point. The chord
+  // joining two points is shorter than their geodesic, but the segments pass
+  // below the surface by up to max_depth_ meters: the bound is increased by
+  // this depth and by 1 percent, to account for the spherical strategies.
+  [[nodiscard]] inline auto chord_bound(const double max_distance) const
+      -> double {
+    if (!(max_distance >= 0)) {
+      throw std::invalid_argument("the maximum distance must be positive");
+    }
+    const auto result = max_distance * 1.01 + max_depth_;
+    return result * result;
+  }
+
+  // Gets the distance to the nearest point, if a coastline segment lies
+  // within the chord bound of max_distance.
+  template <class Strategy>
+  [[nodiscard]] inline auto bounded_distance(const double lon,
+                                             const double lat,
+                                             const Strategy& strategy,
+                                             const double max_distance) const
+      -> std::optional<double> {
+    const auto point = geodetic_2_cartesian(geodetic_2_radian({lon, lat, 0}));
+    const auto ix = nearest_segment(point, {}, chord_bound(max_distance));
+    if (!ix) {
+      return {};
+    }
+    return boost::geometry::distance(
+        geodetic_2_degree(
+            cartesian_2_geodetic(closest_point(point, segment(*ix)))),
+        GeodeticDegree{lon, lat}, strategy);
+  }
+
+  // Gets the nearest points of arrays of points, searched among the
+  // coastline segments whose comparable distance doesn't exceed bound. The
+  // coordinates of the points without such a segment are set to NaN.
+  void nearest_within(const double* lon, const double* lat,
+                      const size_t size, const double bound,
+                      double* nearest_lon, double* nearest_lat) const {
+    nearest_within(lon, lat, size, bound,
+                   [=](const size_t ix, const double x, const double y) {
+                     nearest_lon[ix] = x;
+                     nearest_lat[ix] = y;
+                   });
+  }
+
+  // Same as above, the coordinates of the nearest point of each point being
+  // passed to the consumer with the index of the point. The points are
+  // processed in the Morton order of their coordinates.
+  void nearest_within(
+      const double* lon, const double* lat, size_t size, double bound,
+      const std::function<void(size_t, double, double)>& consume) const;
+
+  // Gets the nearest coastline segments of the points of a regular grid
+  // (see rasterize_distance_to_nearest).
+  auto grid_nearest_segments(double lon0, double lat0, double dlon,
+                             double dlat, size_t nx, size_t ny, bool exact,
+                             size_t num_threads) const
+      -> std::vector<uint32_t>;
+
+  // Gets the point of the nearest coastline segment closest to the given
+  // point.
   [[nodiscard]] inline auto nearest(const Cartesian& point) const -> Cartesian {
-    auto result = std::vector<Cartesian>();
-    std::for_each(rtree_->qbegin(boost::geometry::index::nearest(point, 1)),
-                  rtree_->qend(),
-                  [&result](const auto& item) { result.emplace_back(item); });
-    return result.at(0);
+    return closest_point(point, segment(nearest_segment(point)));
   }
 
   // Bounding box loaded
   std::optional<Box> bbox_;
 
-  // List of polygons read: envelope, polygon and level
-  std::vector<PolygonIndex> polygons_{};
-  using RTree =
-      boost::geometry::index::rtree<Cartesian,
-                                    boost::geometry::index::rstar<16>>;
-  std::unique_ptr<RTree> rtree_{nullptr};
+  // The shorelines are stored in flat arrays, either owned by the instance
+  // or mapped from a cache file.
+  std::shared_ptr<MappedFile> file_{};
+
+  // Level of each polygon
+  Buffer<uint8_t> levels_{};
+  // Envelope of each polygon
+  Buffer<Box> envelopes_{};
+  // Parent of each polygon in the containment tree
+  Buffer<uint32_t> parents_{};
+  // Offset, in x_ and y_, of the outer ring of each polygon
+  Buffer<uint64_t> offsets_{};
+  // Longitudes and latitudes of the points of the polygon rings, stored in
+  // separate arrays for the point-in-polygon tests. The rings are read
+  // through RingView.
+  Buffer<double> x_{};
+  Buffer<double> y_{};
+  // Range of the latitudes of each block of kEdgeBlock edges: the edge ix
+  // joins the points ix and ix + 1, even if they belong to different rings.
+  Buffer<std::array<double, 2>> block_ranges_{};
+  // Latitude bands of each polygon
+  Buffer<Slabs> slabs_{};
+  // Offset, in edges, of the edges of each band in slab_edges_
+  Buffer<uint64_t> slab_offsets_{};
+  // Edges of the bands: the edges of a band of n edges are stored in four
+  // arrays of n values, x0, y0, x1 and y1, following each other.
+  Buffer<double> slab_edges_{};
+  // ECEF coordinates of the points of the polygon rings
+  Buffer<Cartesian> ecef_{};
+  // Maximum depth, in meters, of the coastline segments below the surface of
+  // the ellipsoid.
+  double max_depth_{0};
+
+  // Spatial index of the polygon envelopes: the items are the polygon
+  // indexes.
+  PackedRTree<2> polygon_rtree_{};
+  // Spatial index of the coastline segments, expressed in ECEF coordinates:
+  // the items are the index of the first point of the segments.
+  PackedRTree<3> rtree_{};
+
+  // Acceleration grid of the mask, if requested.
+  std::optional<MaskGrid> grid_{};
 };
 
-}  // namespace gshhg
\ No newline at end of file
+}  // namespace gshhg
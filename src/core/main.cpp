@@ -9,43 +9,32 @@
 namespace py = pybind11;
 
 namespace gshhg {
+// The coordinates are arrays of any shape and layout, broadcast together.
+// The results have the shape of the broadcast arrays.
+
 py::tuple nearest(const GSHHG& self, const py::array_t<double>& lon,
                   const py::array_t<double>& lat, const size_t num_threads) {
-  check_array_ndim("lon", 1, lon, "lat", 1, lat);
-  check_container_size("lon", lon, "lat", lat);
-
-  auto size = lon.size();
-  auto x = py::array_t<double>(py::array::ShapeContainer{size});
-  auto y = py::array_t<double>(py::array::ShapeContainer{size});
+  auto shape = broadcast_shape("lon", lon, "lat", lat);
+  auto x = py::array_t<double>(shape);
+  auto y = py::array_t<double>(shape);
 
-  auto _lon = lon.template unchecked<1>();
-  auto _lat = lat.template unchecked<1>();
-  auto _x = x.template mutable_unchecked<1>();
-  auto _y = y.template mutable_unchecked<1>();
+  const auto _lon = BroadcastReader<double>(lon, shape);
+  const auto _lat = BroadcastReader<double>(lat, shape);
+  auto* _x = x.mutable_data();
+  auto* _y = y.mutable_data();
 
   {
-    // Captures the detected exceptions in the calculation function
-    // (only the last exception captured is kept)
-    auto except = std::exception_ptr(nullptr);
-
     py::gil_scoped_release release;
 
     dispatch(
         [&](const size_t start, const size_t end) {
-          try {
-            for (size_t ix = start; ix < end; ++ix) {
-              auto point = self.nearest(_lon(ix), _lat(ix));
-              _x(ix) = point.get<0>();
-              _y(ix) = point.get<1>();
-            }
-          } catch (...) {
-            except = std::current_exception();
-          }
+          auto lon_buffer = std::vector<double>();
+          auto lat_buffer = std::vector<double>();
+          self.nearest(_lon.read(start, end, lon_buffer),
+                       _lat.read(start, end, lat_buffer), end - start,
+                       _x + start, _y + start);
         },
-        size, num_threads);
-    if (except != nullptr) {
-      std::rethrow_exception(except);
-    }
+        x.size(), num_threads);
   }
   return py::make_tuple(x, y);
 }
@@ -53,79 +42,201 @@ py::tuple nearest(const GSHHG& self, const py::array_t<double>& lon,
 py::array_t<int8_t> mask(const GSHHG& self, const py::array_t<double>& lon,
                          const py::array_t<double>& lat,
                          const size_t num_threads) {
-  check_array_ndim("lon", 1, lon, "lat", 1, lat);
-  check_container_size("lon", lon, "lat", lat);
-
-  auto size = lon.size();
-  auto mask = py::array_t<int8_t>(py::array::ShapeContainer{size});
+  auto shape = broadcast_shape("lon", lon, "lat", lat);
+  auto mask = py::array_t<int8_t>(shape);
 
-  auto _lon = lon.unchecked<1>();
-  auto _lat = lat.unchecked<1>();
-  auto _mask = mask.mutable_unchecked<1>();
+  const auto _lon = BroadcastReader<double>(lon, shape);
+  const auto _lat = BroadcastReader<double>(lat, shape);
+  auto* _mask = mask.mutable_data();
 
   {
-    // Captures the detected exceptions in the calculation function
-    // (only the last exception captured is kept)
-    auto except = std::exception_ptr(nullptr);
-
     py::gil_scoped_release release;
 
     dispatch(
         [&](const size_t start, const size_t end) {
-          try {
-            for (size_t ix = start; ix < end; ++ix) {
-              _mask(ix) = self.mask(_lon(ix), _lat(ix));
-            }
-          } catch (...) {
-            except = std::current_exception();
+          auto x = _lon;
+          auto y = _lat;
+          x.seek(start);
+          y.seek(start);
+          for (size_t ix = start; ix < end; ++ix) {
+            _mask[ix] = self.mask(x.next(), y.next());
           }
         },
-        size, num_threads);
-    if (except != nullptr) {
-      std::rethrow_exception(except);
-    }
+        mask.size(), num_threads);
+  }
+  return mask;
+}
+
+py::array_t<int8_t> rasterize_mask(const GSHHG& self, const double lon0,
+                                   const double lat0, const double dlon,
+                                   const double dlat, const size_t nx,
+                                   const size_t ny, const size_t num_threads) {
+  auto mask = py::array_t<int8_t>(std::vector<size_t>{ny, nx});
+  auto* _mask = reinterpret_cast<uint8_t*>(mask.mutable_data());
+  {
+    py::gil_scoped_release release;
+    self.rasterize_mask(lon0, lat0, dlon, dlat, nx, ny, _mask, num_threads);
   }
   return mask;
 }
 
 template <class Strategy>
-py::array_t<double> distance_to_nearest(const GSHHG& self,
-                                        const py::array_t<double>& lon,
-                                        const py::array_t<double>& lat,
-                                        const Strategy& strategy,
-                                        const size_t num_threads) {
-  check_array_ndim("lon", 1, lon, "lat", 1, lat);
-  check_container_size("lon", lon, "lat", lat);
+py::array_t<double> distance_to_nearest(
+    const GSHHG& self, const py::array_t<double>& lon,
+    const py::array_t<double>& lat, const Strategy& strategy,
+    const size_t num_threads, const std::optional<double>& max_distance) {
+  auto shape = broadcast_shape("lon", lon, "lat", lat);
+  auto result = py::array_t<double>(shape);
+  const auto _max_distance =
+      max_distance.value_or(std::numeric_limits<double>::infinity());
+
+  const auto _lon = BroadcastReader<double>(lon, shape);
+  const auto _lat = BroadcastReader<double>(lat, shape);
+  auto* _result = result.mutable_data();
+
+  {
+    py::gil_scoped_release release;
+
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          auto lon_buffer = std::vector<double>();
+          auto lat_buffer = std::vector<double>();
+          self.distance_to_nearest(_lon.read(start, end, lon_buffer),
+                                   _lat.read(start, end, lat_buffer),
+                                   end - start, strategy, _result + start,
+                                   _max_distance);
+        },
+        result.size(), num_threads);
+  }
+  return result;
+}
 
-  auto size = lon.size();
-  auto result = py::array_t<double>(py::array::ShapeContainer{size});
+template <class Strategy>
+py::array_t<bool> within_distance(const GSHHG& self,
+                                  const py::array_t<double>& lon,
+                                  const py::array_t<double>& lat,
+                                  const double radius, const Strategy& strategy,
+                                  const size_t num_threads) {
+  auto shape = broadcast_shape("lon", lon, "lat", lat);
+  auto result = py::array_t<bool>(shape);
 
-  auto _lon = lon.unchecked<1>();
-  auto _lat = lat.unchecked<1>();
-  auto _result = result.mutable_unchecked<1>();
+  const auto _lon = BroadcastReader<double>(lon, shape);
+  const auto _lat = BroadcastReader<double>(lat, shape);
+  auto* _result = result.mutable_data();
 
   {
-    // Captures the detected exceptions in the calculation function
-    // (only the last exception captured is kept)
-    auto except = std::exception_ptr(nullptr);
+    py::gil_scoped_release release;
+
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          auto lon_buffer = std::vector<double>();
+          auto lat_buffer = std::vector<double>();
+          self.within_distance(_lon.read(start, end, lon_buffer),
+                               _lat.read(start, end, lat_buffer), end - start,
+                               radius, strategy, _result + start);
+        },
+        result.size(), num_threads);
+  }
+  return result;
+}
 
+template <class Strategy>
+py::tuple classify(const GSHHG& self, const py::array_t<double>& lon,
+                   const py::array_t<double>& lat, const Strategy& strategy,
+                   const size_t num_threads) {
+  auto shape = broadcast_shape("lon", lon, "lat", lat);
+  auto mask = py::array_t<int8_t>(shape);
+  auto x = py::array_t<double>(shape);
+  auto y = py::array_t<double>(shape);
+  auto distance = py::array_t<double>(shape);
+
+  const auto _lon = BroadcastReader<double>(lon, shape);
+  const auto _lat = BroadcastReader<double>(lat, shape);
+  auto* _mask = reinterpret_cast<uint8_t*>(mask.mutable_data());
+  auto* _x = x.mutable_data();
+  auto* _y = y.mutable_data();
+  auto* _distance = distance.mutable_data();
+
+  {
     py::gil_scoped_release release;
 
     dispatch(
         [&](const size_t start, const size_t end) {
-          try {
-            for (size_t ix = start; ix < end; ++ix) {
-              _result(ix) =
-                  self.distance_to_nearest(_lon(ix), _lat(ix), strategy);
-            }
-          } catch (...) {
-            except = std::current_exception();
-          }
+          auto lon_buffer = std::vector<double>();
+          auto lat_buffer = std::vector<double>();
+          self.classify(_lon.read(start, end, lon_buffer),
+                        _lat.read(start, end, lat_buffer), end - start,
+                        strategy, _mask + start, _x + start, _y + start,
+                        _distance + start);
         },
-        size, num_threads);
-    if (except != nullptr) {
-      std::rethrow_exception(except);
-    }
+        mask.size(), num_threads);
+  }
+  return py::make_tuple(mask, x, y, distance);
+}
+
+template <class Strategy>
+py::array_t<double> rasterize_distance_to_nearest(
+    const GSHHG& self, const double lon0, const double lat0, const double dlon,
+    const double dlat, const size_t nx, const size_t ny,
+    const Strategy& strategy, const bool exact, const size_t num_threads) {
+  auto result = py::array_t<double>(std::vector<size_t>{ny, nx});
+  auto* _result = result.mutable_data();
+  {
+    py::gil_scoped_release release;
+    self.rasterize_distance_to_nearest(lon0, lat0, dlon, dlat, nx, ny,
+                                       strategy, exact, _result, num_threads);
+  }
+  return result;
+}
+
+// Gets the set of the land levels selected, all the levels by default.
+static auto land_levels(const std::optional<std::vector<int>>& land)
+    -> uint8_t {
+  return land ? GSHHG::land_levels(*land) : GSHHG::kLand;
+}
+
+template <class Strategy>
+py::array_t<double> signed_distance(
+    const GSHHG& self, const py::array_t<double>& lon,
+    const py::array_t<double>& lat, const Strategy& strategy,
+    const std::optional<std::vector<int>>& land, const size_t num_threads) {
+  auto shape = broadcast_shape("lon", lon, "lat", lat);
+  auto result = py::array_t<double>(shape);
+  const auto _land = land_levels(land);
+
+  const auto _lon = BroadcastReader<double>(lon, shape);
+  const auto _lat = BroadcastReader<double>(lat, shape);
+  auto* _result = result.mutable_data();
+
+  {
+    py::gil_scoped_release release;
+
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          auto lon_buffer = std::vector<double>();
+          auto lat_buffer = std::vector<double>();
+          self.signed_distance(_lon.read(start, end, lon_buffer),
+                               _lat.read(start, end, lat_buffer),
+                               end - start, strategy, _land, _result + start);
+        },
+        result.size(), num_threads);
+  }
+  return result;
+}
+
+template <class Strategy>
+py::array_t<double> rasterize_signed_distance(
+    const GSHHG& self, const double lon0, const double lat0, const double dlon,
+    const double dlat, const size_t nx, const size_t ny,
+    const Strategy& strategy, const std::optional<std::vector<int>>& land,
+    const bool exact, const size_t num_threads) {
+  auto result = py::array_t<double>(std::vector<size_t>{ny, nx});
+  auto* _result = result.mutable_data();
+  const auto _land = land_levels(land);
+  {
+    py::gil_scoped_release release;
+    self.rasterize_signed_distance(lon0, lat0, dlon, dlat, nx, ny, strategy,
+                                   _land, exact, _result, num_threads);
   }
   return result;
 }
@@ -210,7 +321,9 @@ PYBIND11_MODULE(core, m) {
                        const std::optional<std::string>& resolution,
                        const std::optional<std::vector<int>>& levels,
                        const std::optional<
-                           std::tuple<double, double, double, double>>& bbox) {
+                           std::tuple<double, double, double, double>>& bbox,
+                       const std::optional<double>& grid_step,
+                       const std::optional<std::string>& cache) {
              auto box =
                  bbox.has_value()
                      ? std::make_optional<gshhg::Box>(
@@ -218,10 +331,11 @@ PYBIND11_MODULE(core, m) {
                            gshhg::Point{std::get<2>(*bbox), std::get<3>(*bbox)})
                      : std::optional<gshhg::Box>();
              return std::make_unique<gshhg::GSHHG>(filename, resolution, levels,
-                                                   box);
+                                                   box, grid_step, cache);
            }),
            py::arg("dirname"), py::arg("resolution") = py::none(),
            py::arg("levels") = py::none(), py::arg("bbox") = py::none(),
+           py::arg("grid_step") = py::none(), py::arg("cache") = py::none(),
            py::call_guard<py::gil_scoped_release>())
       .def("points", &gshhg::GSHHG::points)
       .def("polygons", &gshhg::GSHHG::polygons)
@@ -241,48 +355,217 @@ PYBIND11_MODULE(core, m) {
           [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
              const py::array_t<double>& lat,
              const std::optional<gshhg::Andoyer>& strategy,
-             const size_t num_threads) -> py::array_t<double> {
+             const size_t num_threads,
+             const std::optional<double>& max_distance)
+              -> py::array_t<double> {
             return gshhg::distance_to_nearest(
                 self, lon, lat, strategy.value_or(gshhg::Andoyer()),
-                num_threads);
+                num_threads, max_distance);
           },
           py::arg("lon"), py::arg("lat"), py::arg("strategy") = py::none(),
-          py::arg("num_threads") = 0)
+          py::arg("num_threads") = 0, py::arg("max_distance") = py::none())
       .def(
           "distance_to_nearest",
           [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
              const py::array_t<double>& lat,
              const std::optional<gshhg::Haversine>& strategy,
-             const size_t num_threads) -> py::array_t<double> {
+             const size_t num_threads,
+             const std::optional<double>& max_distance)
+              -> py::array_t<double> {
             return gshhg::distance_to_nearest(
                 self, lon, lat, strategy.value_or(gshhg::Haversine()),
-                num_threads);
+                num_threads, max_distance);
           },
           py::arg("lon"), py::arg("lat"), py::arg("strategy"),
-          py::arg("num_threads") = 0)
+          py::arg("num_threads") = 0, py::arg("max_distance") = py::none())
       .def(
           "distance_to_nearest",
           [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
              const py::array_t<double>& lat,
              std::optional<gshhg::Thomas>& strategy,
-             const size_t num_threads) -> py::array_t<double> {
+             const size_t num_threads,
+             const std::optional<double>& max_distance)
+              -> py::array_t<double> {
             return gshhg::distance_to_nearest(
                 self, lon, lat, strategy.value_or(gshhg::Thomas()),
-                num_threads);
+                num_threads, max_distance);
           },
           py::arg("lon"), py::arg("lat"), py::arg("strategy"),
-          py::arg("num_threads") = 0)
+          py::arg("num_threads") = 0, py::arg("max_distance") = py::none())
       .def(
           "distance_to_nearest",
           [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
              const py::array_t<double>& lat,
              const std::optional<gshhg::Vincenty>& strategy,
-             const size_t num_threads) -> py::array_t<double> {
+             const size_t num_threads,
+             const std::optional<double>& max_distance)
+              -> py::array_t<double> {
             return gshhg::distance_to_nearest(
                 self, lon, lat, strategy.value_or(gshhg::Vincenty()),
-                num_threads);
+                num_threads, max_distance);
           },
           py::arg("lon"), py::arg("lat"), py::arg("strategy"),
+          py::arg("num_threads") = 0, py::arg("max_distance") = py::none())
+      .def(
+          "within_distance",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat, const double radius,
+             const std::optional<gshhg::Andoyer>& strategy,
+             const size_t num_threads) -> py::array_t<bool> {
+            return gshhg::within_distance(self, lon, lat, radius,
+                                          strategy.value_or(gshhg::Andoyer()),
+                                          num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("radius"),
+          py::arg("strategy") = py::none(), py::arg("num_threads") = 0)
+      .def(
+          "within_distance",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat, const double radius,
+             const std::optional<gshhg::Haversine>& strategy,
+             const size_t num_threads) -> py::array_t<bool> {
+            return gshhg::within_distance(self, lon, lat, radius,
+                                          strategy.value_or(gshhg::Haversine()),
+                                          num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("radius"),
+          py::arg("strategy"), py::arg("num_threads") = 0)
+      .def(
+          "within_distance",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat, const double radius,
+             const std::optional<gshhg::Thomas>& strategy,
+             const size_t num_threads) -> py::array_t<bool> {
+            return gshhg::within_distance(self, lon, lat, radius,
+                                          strategy.value_or(gshhg::Thomas()),
+                                          num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("radius"),
+          py::arg("strategy"), py::arg("num_threads") = 0)
+      .def(
+          "within_distance",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat, const double radius,
+             const std::optional<gshhg::Vincenty>& strategy,
+             const size_t num_threads) -> py::array_t<bool> {
+            return gshhg::within_distance(self, lon, lat, radius,
+                                          strategy.value_or(gshhg::Vincenty()),
+                                          num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("radius"),
+          py::arg("strategy"), py::arg("num_threads") = 0)
+      .def(
+          "signed_distance",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat,
+             const std::optional<gshhg::Andoyer>& strategy,
+             const std::optional<std::vector<int>>& land,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::signed_distance(self, lon, lat,
+                                          strategy.value_or(gshhg::Andoyer()),
+                                          land, num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("strategy") = py::none(),
+          py::arg("land") = py::none(), py::arg("num_threads") = 0)
+      .def(
+          "signed_distance",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat,
+             const std::optional<gshhg::Haversine>& strategy,
+             const std::optional<std::vector<int>>& land,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::signed_distance(self, lon, lat,
+                                          strategy.value_or(gshhg::Haversine()),
+                                          land, num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("strategy"),
+          py::arg("land") = py::none(), py::arg("num_threads") = 0)
+      .def(
+          "signed_distance",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat,
+             const std::optional<gshhg::Thomas>& strategy,
+             const std::optional<std::vector<int>>& land,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::signed_distance(self, lon, lat,
+                                          strategy.value_or(gshhg::Thomas()),
+                                          land, num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("strategy"),
+          py::arg("land") = py::none(), py::arg("num_threads") = 0)
+      .def(
+          "signed_distance",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat,
+             const std::optional<gshhg::Vincenty>& strategy,
+             const std::optional<std::vector<int>>& land,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::signed_distance(self, lon, lat,
+                                          strategy.value_or(gshhg::Vincenty()),
+                                          land, num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("strategy"),
+          py::arg("land") = py::none(), py::arg("num_threads") = 0)
+      .def(
+          "rasterize_signed_distance",
+          [](const gshhg::GSHHG& self, const double lon0, const double lat0,
+             const double dlon, const double dlat, const size_t nx,
+             const size_t ny, const std::optional<gshhg::Andoyer>& strategy,
+             const std::optional<std::vector<int>>& land, const bool exact,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::rasterize_signed_distance(
+                self, lon0, lat0, dlon, dlat, nx, ny,
+                strategy.value_or(gshhg::Andoyer()), land, exact, num_threads);
+          },
+          py::arg("lon0"), py::arg("lat0"), py::arg("dlon"), py::arg("dlat"),
+          py::arg("nx"), py::arg("ny"), py::arg("strategy") = py::none(),
+          py::arg("land") = py::none(), py::arg("exact") = true,
+          py::arg("num_threads") = 0)
+      .def(
+          "rasterize_signed_distance",
+          [](const gshhg::GSHHG& self, const double lon0, const double lat0,
+             const double dlon, const double dlat, const size_t nx,
+             const size_t ny, const std::optional<gshhg::Haversine>& strategy,
+             const std::optional<std::vector<int>>& land, const bool exact,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::rasterize_signed_distance(
+                self, lon0, lat0, dlon, dlat, nx, ny,
+                strategy.value_or(gshhg::Haversine()), land, exact,
+                num_threads);
+          },
+          py::arg("lon0"), py::arg("lat0"), py::arg("dlon"), py::arg("dlat"),
+          py::arg("nx"), py::arg("ny"), py::arg("strategy"),
+          py::arg("land") = py::none(), py::arg("exact") = true,
+          py::arg("num_threads") = 0)
+      .def(
+          "rasterize_signed_distance",
+          [](const gshhg::GSHHG& self, const double lon0, const double lat0,
+             const double dlon, const double dlat, const size_t nx,
+             const size_t ny, const std::optional<gshhg::Thomas>& strategy,
+             const std::optional<std::vector<int>>& land, const bool exact,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::rasterize_signed_distance(
+                self, lon0, lat0, dlon, dlat, nx, ny,
+                strategy.value_or(gshhg::Thomas()), land, exact, num_threads);
+          },
+          py::arg("lon0"), py::arg("lat0"), py::arg("dlon"), py::arg("dlat"),
+          py::arg("nx"), py::arg("ny"), py::arg("strategy"),
+          py::arg("land") = py::none(), py::arg("exact") = true,
+          py::arg("num_threads") = 0)
+      .def(
+          "rasterize_signed_distance",
+          [](const gshhg::GSHHG& self, const double lon0, const double lat0,
+             const double dlon, const double dlat, const size_t nx,
+             const size_t ny, const std::optional<gshhg::Vincenty>& strategy,
+             const std::optional<std::vector<int>>& land, const bool exact,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::rasterize_signed_distance(
+                self, lon0, lat0, dlon, dlat, nx, ny,
+                strategy.value_or(gshhg::Vincenty()), land, exact, num_threads);
+          },
+          py::arg("lon0"), py::arg("lat0"), py::arg("dlon"), py::arg("dlat"),
+          py::arg("nx"), py::arg("ny"), py::arg("strategy"),
+          py::arg("land") = py::none(), py::arg("exact") = true,
           py::arg("num_threads") = 0)
       .def(
           "mask",
@@ -291,5 +574,119 @@ PYBIND11_MODULE(core, m) {
              const size_t num_threads) -> py::array_t<int8_t> {
             return gshhg::mask(self, lon, lat, num_threads);
           },
-          py::arg("lon"), py::arg("lat"), py::arg("num_threads") = 0);
+          py::arg("lon"), py::arg("lat"), py::arg("num_threads") = 0)
+      .def(
+          "classify",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat,
+             const std::optional<gshhg::Andoyer>& strategy,
+             const size_t num_threads) -> py::tuple {
+            return gshhg::classify(self, lon, lat,
+                                   strategy.value_or(gshhg::Andoyer()),
+                                   num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("strategy") = py::none(),
+          py::arg("num_threads") = 0)
+      .def(
+          "classify",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat,
+             const std::optional<gshhg::Haversine>& strategy,
+             const size_t num_threads) -> py::tuple {
+            return gshhg::classify(self, lon, lat,
+                                   strategy.value_or(gshhg::Haversine()),
+                                   num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("strategy"),
+          py::arg("num_threads") = 0)
+      .def(
+          "classify",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat,
+             const std::optional<gshhg::Thomas>& strategy,
+             const size_t num_threads) -> py::tuple {
+            return gshhg::classify(self, lon, lat,
+                                   strategy.value_or(gshhg::Thomas()),
+                                   num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("strategy"),
+          py::arg("num_threads") = 0)
+      .def(
+          "classify",
+          [](const gshhg::GSHHG& self, const py::array_t<double>& lon,
+             const py::array_t<double>& lat,
+             const std::optional<gshhg::Vincenty>& strategy,
+             const size_t num_threads) -> py::tuple {
+            return gshhg::classify(self, lon, lat,
+                                   strategy.value_or(gshhg::Vincenty()),
+                                   num_threads);
+          },
+          py::arg("lon"), py::arg("lat"), py::arg("strategy"),
+          py::arg("num_threads") = 0)
+      .def(
+          "rasterize_mask",
+          [](const gshhg::GSHHG& self, const double lon0, const double lat0,
+             const double dlon, const double dlat, const size_t nx,
+             const size_t ny, const size_t num_threads) -> py::array_t<int8_t> {
+            return gshhg::rasterize_mask(self, lon0, lat0, dlon, dlat, nx, ny,
+                                         num_threads);
+          },
+          py::arg("lon0"), py::arg("lat0"), py::arg("dlon"), py::arg("dlat"),
+          py::arg("nx"), py::arg("ny"), py::arg("num_threads") = 0)
+      .def(
+          "rasterize_distance_to_nearest",
+          [](const gshhg::GSHHG& self, const double lon0, const double lat0,
+             const double dlon, const double dlat, const size_t nx,
+             const size_t ny, const std::optional<gshhg::Andoyer>& strategy,
+             const bool exact,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::rasterize_distance_to_nearest(
+                self, lon0, lat0, dlon, dlat, nx, ny,
+                strategy.value_or(gshhg::Andoyer()), exact, num_threads);
+          },
+          py::arg("lon0"), py::arg("lat0"), py::arg("dlon"), py::arg("dlat"),
+          py::arg("nx"), py::arg("ny"), py::arg("strategy") = py::none(),
+          py::arg("exact") = true, py::arg("num_threads") = 0)
+      .def(
+          "rasterize_distance_to_nearest",
+          [](const gshhg::GSHHG& self, const double lon0, const double lat0,
+             const double dlon, const double dlat, const size_t nx,
+             const size_t ny, const std::optional<gshhg::Haversine>& strategy,
+             const bool exact,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::rasterize_distance_to_nearest(
+                self, lon0, lat0, dlon, dlat, nx, ny,
+                strategy.value_or(gshhg::Haversine()), exact, num_threads);
+          },
+          py::arg("lon0"), py::arg("lat0"), py::arg("dlon"), py::arg("dlat"),
+          py::arg("nx"), py::arg("ny"), py::arg("strategy"),
+          py::arg("exact") = true, py::arg("num_threads") = 0)
+      .def(
+          "rasterize_distance_to_nearest",
+          [](const gshhg::GSHHG& self, const double lon0, const double lat0,
+             const double dlon, const double dlat, const size_t nx,
+             const size_t ny, const std::optional<gshhg::Thomas>& strategy,
+             const bool exact,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::rasterize_distance_to_nearest(
+                self, lon0, lat0, dlon, dlat, nx, ny,
+                strategy.value_or(gshhg::Thomas()), exact, num_threads);
+          },
+          py::arg("lon0"), py::arg("lat0"), py::arg("dlon"), py::arg("dlat"),
+          py::arg("nx"), py::arg("ny"), py::arg("strategy"),
+          py::arg("exact") = true, py::arg("num_threads") = 0)
+      .def(
+          "rasterize_distance_to_nearest",
+          [](const gshhg::GSHHG& self, const double lon0, const double lat0,
+             const double dlon, const double dlat, const size_t nx,
+             const size_t ny, const std::optional<gshhg::Vincenty>& strategy,
+             const bool exact,
+             const size_t num_threads) -> py::array_t<double> {
+            return gshhg::rasterize_distance_to_nearest(
+                self, lon0, lat0, dlon, dlat, nx, ny,
+                strategy.value_or(gshhg::Vincenty()), exact, num_threads);
+          },
+          py::arg("lon0"), py::arg("lat0"), py::arg("dlon"), py::arg("dlat"),
+          py::arg("nx"), py::arg("ny"), py::arg("strategy"),
+          py::arg("exact") = true, py::arg("num_threads") = 0);
 }
\ No newline at end of file
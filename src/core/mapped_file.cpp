@@ -0,0 +1,99 @@
+#include "mapped_file.hpp"
+
+#include <system_error>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gshhg {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename) {
+  file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) {
+    file_ = nullptr;
+    throw std::system_error(static_cast<int>(GetLastError()),
+                            std::system_category(), filename);
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file_, &size)) {
+    auto code = static_cast<int>(GetLastError());
+    CloseHandle(file_);
+    throw std::system_error(code, std::system_category(), filename);
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+  if (size_ == 0) {
+    return;
+  }
+  mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_ == nullptr) {
+    auto code = static_cast<int>(GetLastError());
+    CloseHandle(file_);
+    throw std::system_error(code, std::system_category(), filename);
+  }
+  data_ = static_cast<const char*>(
+      MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr) {
+    auto code = static_cast<int>(GetLastError());
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+    throw std::system_error(code, std::system_category(), filename);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+  }
+  if (file_ != nullptr) {
+    CloseHandle(file_);
+  }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename) {
+  auto fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::system_error(errno, std::system_category(), filename);
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) == -1) {
+    auto code = errno;
+    ::close(fd);
+    throw std::system_error(code, std::system_category(), filename);
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ != 0) {
+    auto* data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      auto code = errno;
+      ::close(fd);
+      throw std::system_error(code, std::system_category(), filename);
+    }
+    data_ = static_cast<const char*>(data);
+  }
+  // The mapping remains valid once the file descriptor is closed.
+  ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+#endif
+
+}  // namespace gshhg
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace gshhg {
+
+/// Read-only memory mapping of a whole file. The pages of the file are
+/// shared by all the processes mapping it.
+class MappedFile {
+ public:
+  /// Map the file
+  ///
+  /// @param filename Path to the file to map.
+  /// @throw std::system_error if the file cannot be opened or mapped.
+  explicit MappedFile(const std::string& filename);
+
+  /// Unmap the file
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  auto operator=(const MappedFile&) -> MappedFile& = delete;
+  MappedFile(MappedFile&&) = delete;
+  auto operator=(MappedFile&&) -> MappedFile& = delete;
+
+  /// Gets the address of the first byte of the file
+  [[nodiscard]] inline auto data() const noexcept -> const char* {
+    return data_;
+  }
+
+  /// Gets the size of the file
+  [[nodiscard]] inline auto size() const noexcept -> size_t { return size_; }
+
+ private:
+  const char* data_{nullptr};
+  size_t size_{0};
+#ifdef _WIN32
+  void* file_{nullptr};
+  void* mapping_{nullptr};
+#endif
+};
+
+}  // namespace gshhg
@@ -0,0 +1,525 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "buffer.hpp"
+#include "thread.hpp"
+
+namespace gshhg {
+
+/// Static R-tree bulk-loaded with the Sort-Tile-Recursive (STR) algorithm.
+///
+/// The nodes are stored level by level in flat arrays, from the leaves to the
+/// root: the tree can be written as is in a file and queried in place from a
+/// memory mapping of this file. Each entry of a leaf stores the index of an
+/// item, each entry of the other levels stores the position of the first of
+/// its children.
+///
+/// @tparam N Number of dimensions of the indexed space.
+template <size_t N>
+class PackedRTree {
+ public:
+  /// Maximum number of children of a node
+  static constexpr size_t kNodeSize = 16;
+
+  /// Bounds of an entry: minimum corner followed by the maximum corner.
+  using Bounds = std::array<double, 2 * N>;
+
+  /// Coordinates of a point
+  using Coordinates = std::array<double, N>;
+
+  /// Item to index: its bounds and its index
+  using Item = std::pair<Bounds, uint32_t>;
+
+  /// Default constructor: empty tree
+  PackedRTree() = default;
+
+  /// Build the tree from its serialized representation
+  ///
+  /// @param bounds Bounds of the entries.
+  /// @param indices Item indexes stored by the leaves, or position of the
+  /// first children stored by the other nodes.
+  /// @param levels Position following the last entry of each level.
+  /// @throw std::invalid_argument if the levels or the positions of the
+  /// children are inconsistent.
+  PackedRTree(Buffer<Bounds>&& bounds, Buffer<uint32_t>&& indices,
+              Buffer<uint64_t>&& levels)
+      : bounds_(std::move(bounds)),
+        indices_(std::move(indices)),
+        levels_(std::move(levels)) {
+    if (bounds_.size() != indices_.size() || levels_.size() > kMaxDepth ||
+        (levels_.empty() ? !bounds_.empty()
+                         : levels_.back() != bounds_.size())) {
+      throw std::invalid_argument("inconsistent R-tree layout");
+    }
+    // The levels are not empty, the last one holding only the root, and the
+    // entries of the nodes reference a child of the level below.
+    for (size_t level = 0; level < levels_.size(); ++level) {
+      const auto first = level == 0 ? 0 : levels_[level - 1];
+      if (levels_[level] <= first ||
+          (level + 1 == levels_.size() && levels_[level] - first != 1)) {
+        throw std::invalid_argument("inconsistent R-tree layout");
+      }
+      if (level == 0) {
+        continue;
+      }
+      const auto children = level == 1 ? 0 : levels_[level - 2];
+      for (auto ix = first; ix < levels_[level]; ++ix) {
+        if (indices_[ix] < children || indices_[ix] >= first) {
+          throw std::invalid_argument("inconsistent R-tree layout");
+        }
+      }
+    }
+  }
+
+  /// Bulk-load the tree. The items are sorted and the nodes are built in
+  /// parallel.
+  ///
+  /// @param items Items to index.
+  static auto build(const std::vector<Item>& items) -> PackedRTree {
+    // The positions of the entries, leaves and nodes, must fit in 32 bits.
+    if (items.size() > std::numeric_limits<uint32_t>::max() / 2) {
+      throw std::length_error("too many items to index");
+    }
+    if (items.empty()) {
+      return {};
+    }
+
+    // Sort the items with the STR algorithm
+    auto order = std::vector<uint32_t>(items.size());
+    std::iota(order.begin(), order.end(), 0);
+    sort_tile_recursive(items, order.begin(), order.end(), 0);
+
+    // Position following the last entry of each level
+    auto levels = std::vector<uint64_t>{items.size()};
+    for (auto size = items.size(); size > 1;) {
+      size = (size + kNodeSize - 1) / kNodeSize;
+      levels.push_back(levels.back() + size);
+    }
+
+    auto bounds = std::vector<Bounds>(levels.back());
+    auto indices = std::vector<uint32_t>(levels.back());
+
+    // Leaves
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          for (auto ix = start; ix < end; ++ix) {
+            bounds[ix] = items[order[ix]].first;
+            indices[ix] = items[order[ix]].second;
+          }
+        },
+        order.size(), 0);
+
+    // Each node of the upper levels bounds a group of consecutive entries of
+    // the level below.
+    for (size_t level = 1; level < levels.size(); ++level) {
+      const auto first = level == 1 ? 0 : levels[level - 2];
+      const auto last = levels[level - 1];
+      dispatch(
+          [&](const size_t start, const size_t end) {
+            for (auto node = start; node < end; ++node) {
+              const auto child = first + node * kNodeSize;
+              auto box = bounds[child];
+              for (auto ix = child + 1; ix < std::min(child + kNodeSize, last);
+                   ++ix) {
+                expand(box, bounds[ix]);
+              }
+              bounds[last + node] = box;
+              indices[last + node] = static_cast<uint32_t>(child);
+            }
+          },
+          levels[level] - last, 0);
+    }
+    return PackedRTree(Buffer<Bounds>(std::move(bounds)),
+                       Buffer<uint32_t>(std::move(indices)),
+                       Buffer<uint64_t>(std::move(levels)));
+  }
+
+  /// Gets the number of items indexed
+  [[nodiscard]] inline auto size() const noexcept -> size_t {
+    return levels_.empty() ? 0 : levels_[0];
+  }
+
+  /// Returns true if the tree is empty
+  [[nodiscard]] inline auto empty() const noexcept -> bool {
+    return levels_.empty();
+  }
+
+  /// Gets the bounds of the entries
+  [[nodiscard]] inline auto bounds() const noexcept -> const Buffer<Bounds>& {
+    return bounds_;
+  }
+
+  /// Gets the indexes stored by the entries
+  [[nodiscard]] inline auto indices() const noexcept
+      -> const Buffer<uint32_t>& {
+    return indices_;
+  }
+
+  /// Gets the position following the last entry of each level
+  [[nodiscard]] inline auto levels() const noexcept
+      -> const Buffer<uint64_t>& {
+    return levels_;
+  }
+
+  /// Calls the callback for each item whose bounds satisfy the predicate.
+  ///
+  /// @param predicate Function called with the bounds of the entries, which
+  /// returns true if the entry must be explored.
+  /// @param callback Function called with the index of each item found.
+  template <typename Predicate, typename Callback>
+  void query(const Predicate& predicate, const Callback& callback) const {
+    if (empty()) {
+      return;
+    }
+    // Position of the first entry of the groups of siblings to explore
+    auto stack = std::array<uint64_t, kNodeSize * kMaxDepth>();
+    auto top = size_t(0);
+    auto first = bounds_.size() - 1;
+    const auto leaves = levels_[0];
+
+    while (true) {
+      const auto last = std::min(first + kNodeSize, upper_bound(first));
+      for (auto ix = first; ix < last; ++ix) {
+        if (!predicate(bounds_[ix])) {
+          continue;
+        }
+        if (first < leaves) {
+          callback(indices_[ix]);
+        } else {
+          stack[top++] = indices_[ix];
+        }
+      }
+      if (top == 0) {
+        return;
+      }
+      first = stack[--top];
+    }
+  }
+
+  /// Calls the callback for each item whose bounds contain the point.
+  template <typename Callback>
+  void query(const Coordinates& point, const Callback& callback) const {
+    query(
+        [&point](const Bounds& bounds) -> bool {
+          for (size_t ix = 0; ix < N; ++ix) {
+            if (point[ix] < bounds[ix] || point[ix] > bounds[N + ix]) {
+              return false;
+            }
+          }
+          return true;
+        },
+        callback);
+  }
+
+  /// Searches for the item nearest to the point. The tree is traversed
+  /// depth-first, the children of the nodes being visited by increasing
+  /// distance, without allocating memory.
+  ///
+  /// @param point Point to process.
+  /// @param distance Function returning the squared distance between the
+  /// point and an item.
+  /// @param hint Item assumed to be close to the point, e.g. the nearest
+  /// item of a neighboring point: its distance prunes the search.
+  /// @param max_distance Squared distance beyond which the items are
+  /// ignored: the nodes farther from the point are not explored.
+  /// @return The index of the nearest item and its squared distance to the
+  /// point or nothing if the tree is empty or if no item lies within
+  /// max_distance. Among items at the same distance, the one with the lowest
+  /// index is returned, whatever the hint.
+  template <typename Distance>
+  [[nodiscard]] auto nearest(
+      const Coordinates& point, const Distance& distance,
+      const std::optional<uint32_t>& hint = {},
+      const double max_distance = std::numeric_limits<double>::infinity())
+      const -> std::optional<std::pair<uint32_t, double>> {
+    if (empty()) {
+      return {};
+    }
+    auto result = std::optional<std::pair<uint32_t, double>>();
+    auto bound = max_distance;
+    if (hint) {
+      const auto item = distance(*hint);
+      if (!(item > bound)) {
+        bound = item;
+        result = std::make_pair(*hint, bound);
+      }
+    }
+
+    // Entries to explore and their distances to the point, the nearest
+    // being on the top of the stack.
+    using Entry = std::pair<double, uint64_t>;
+    auto stack = std::array<Entry, kNodeSize * kMaxDepth>();
+    auto top = size_t(0);
+    auto first = bounds_.size() - 1;
+    const auto leaves = levels_[0];
+
+    while (true) {
+      const auto last = std::min(first + kNodeSize, upper_bound(first));
+      if (first < leaves) {
+        for (auto ix = first; ix < last; ++ix) {
+          const auto item = distance(indices_[ix]);
+          if (item < bound ||
+              (item == bound && (!result || indices_[ix] < result->first))) {
+            bound = item;
+            result = std::make_pair(indices_[ix], item);
+          }
+        }
+      } else {
+        const auto base = top;
+        for (auto ix = first; ix < last; ++ix) {
+          const auto item = min_distance(point, bounds_[ix]);
+          if (item <= bound) {
+            stack[top++] = {item, ix};
+          }
+        }
+        std::sort(stack.begin() + static_cast<ptrdiff_t>(base),
+                  stack.begin() + static_cast<ptrdiff_t>(top),
+                  std::greater<>());
+      }
+      // Next entry that may contain a nearer item, or an item as near with
+      // a lower index.
+      while (top != 0 && !(stack[top - 1].first <= bound)) {
+        --top;
+      }
+      if (top == 0) {
+        return result;
+      }
+      first = indices_[stack[--top].second];
+    }
+  }
+
+  /// Searches for the k items nearest to the point, without allocating
+  /// memory: the items found are written into buffers of the caller, sorted
+  /// by increasing distance.
+  ///
+  /// @param point Point to process.
+  /// @param distance Function returning the squared distance between the
+  /// point and an item.
+  /// @param k Number of items to search for.
+  /// @param indices Buffer of at least k elements receiving the indices of
+  /// the items found.
+  /// @param distances Buffer of at least k elements receiving the squared
+  /// distances of the items found.
+  /// @return The number of items found: k, or the size of the tree if it is
+  /// smaller.
+  template <typename Distance, typename Index>
+  auto nearest(const Coordinates& point, const Distance& distance,
+               const size_t k, Index* indices, double* distances) const
+      -> size_t {
+    if (empty() || k == 0) {
+      return 0;
+    }
+    // The items found are kept in a max-heap on their distances, whose top
+    // is the bound of the search once k items have been found.
+    auto count = size_t(0);
+    auto bound = std::numeric_limits<double>::infinity();
+
+    using Entry = std::pair<double, uint64_t>;
+    auto stack = std::array<Entry, kNodeSize * kMaxDepth>();
+    auto top = size_t(0);
+    auto first = bounds_.size() - 1;
+    const auto leaves = levels_[0];
+
+    while (true) {
+      const auto last = std::min(first + kNodeSize, upper_bound(first));
+      if (first < leaves) {
+        for (auto ix = first; ix < last; ++ix) {
+          const auto item = distance(indices_[ix]);
+          if (count < k) {
+            sift_up(indices, distances, count++,
+                    static_cast<Index>(indices_[ix]), item);
+          } else if (item < bound) {
+            sift_down(indices, distances, count,
+                      static_cast<Index>(indices_[ix]), item);
+          } else {
+            continue;
+          }
+          if (count == k) {
+            bound = distances[0];
+          }
+        }
+      } else {
+        const auto base = top;
+        for (auto ix = first; ix < last; ++ix) {
+          const auto item = min_distance(point, bounds_[ix]);
+          if (item < bound) {
+            stack[top++] = {item, ix};
+          }
+        }
+        std::sort(stack.begin() + static_cast<ptrdiff_t>(base),
+                  stack.begin() + static_cast<ptrdiff_t>(top),
+                  std::greater<>());
+      }
+      while (top != 0 && !(stack[top - 1].first < bound)) {
+        --top;
+      }
+      if (top == 0) {
+        break;
+      }
+      first = indices_[stack[--top].second];
+    }
+
+    // Heap sort of the items found
+    for (auto size = count; size > 1; --size) {
+      const auto index = indices[size - 1];
+      const auto item = distances[size - 1];
+      indices[size - 1] = indices[0];
+      distances[size - 1] = distances[0];
+      sift_down(indices, distances, size - 1, index, item);
+    }
+    return count;
+  }
+
+  /// Squared distance between a point and the bounds of an entry
+  [[nodiscard]] static inline auto min_distance(const Coordinates& point,
+                                                const Bounds& bounds) noexcept
+      -> double {
+    auto result = 0.0;
+    for (size_t ix = 0; ix < N; ++ix) {
+      const auto delta = std::max(
+          {bounds[ix] - point[ix], point[ix] - bounds[N + ix], 0.0});
+      result += delta * delta;
+    }
+    return result;
+  }
+
+ private:
+  // Maximum depth of a tree indexing 2^32 items.
+  static constexpr size_t kMaxDepth = 9;
+
+  Buffer<Bounds> bounds_{};
+  Buffer<uint32_t> indices_{};
+  Buffer<uint64_t> levels_{};
+
+  // Gets the position following the last entry of the level containing the
+  // given position.
+  [[nodiscard]] inline auto upper_bound(const uint64_t position) const
+      -> uint64_t {
+    for (const auto item : levels_) {
+      if (position < item) {
+        return item;
+      }
+    }
+    return levels_.back();
+  }
+
+  // Inserts an item at the position of the max-heap of the items found
+  template <typename Index>
+  static inline auto sift_up(Index* indices, double* distances,
+                             size_t position, const Index index,
+                             const double item) -> void {
+    while (position != 0) {
+      const auto parent = (position - 1) / 2;
+      if (!(distances[parent] < item)) {
+        break;
+      }
+      indices[position] = indices[parent];
+      distances[position] = distances[parent];
+      position = parent;
+    }
+    indices[position] = index;
+    distances[position] = item;
+  }
+
+  // Replaces the top of the max-heap of the items found
+  template <typename Index>
+  static inline auto sift_down(Index* indices, double* distances,
+                               const size_t size, const Index index,
+                               const double item) -> void {
+    auto position = size_t(0);
+    while (true) {
+      auto child = 2 * position + 1;
+      if (child >= size) {
+        break;
+      }
+      if (child + 1 < size && distances[child] < distances[child + 1]) {
+        ++child;
+      }
+      if (!(item < distances[child])) {
+        break;
+      }
+      indices[position] = indices[child];
+      distances[position] = distances[child];
+      position = child;
+    }
+    indices[position] = index;
+    distances[position] = item;
+  }
+
+  // Enlarge the bounds to contain other bounds
+  static inline auto expand(Bounds& bounds, const Bounds& other) -> void {
+    for (size_t ix = 0; ix < N; ++ix) {
+      bounds[ix] = std::min(bounds[ix], other[ix]);
+      bounds[N + ix] = std::max(bounds[N + ix], other[N + ix]);
+    }
+  }
+
+  // Sort the items in the Sort-Tile-Recursive order: the items are cut
+  // into slabs along the current axis, each slab being processed in the
+  // same way along the next axis. The items are sorted along the last axis.
+  static void sort_tile_recursive(const std::vector<Item>& items,
+                                  std::vector<uint32_t>::iterator first,
+                                  std::vector<uint32_t>::iterator last,
+                                  const size_t axis) {
+    auto compare = [&items, axis](const uint32_t lhs, const uint32_t rhs) {
+      const auto& a = items[lhs].first;
+      const auto& b = items[rhs].first;
+      return a[axis] + a[N + axis] < b[axis] + b[N + axis];
+    };
+    if (axis == N - 1) {
+      std::sort(first, last, compare);
+      return;
+    }
+    const auto size = static_cast<size_t>(std::distance(first, last));
+    const auto leaves = (size + kNodeSize - 1) / kNodeSize;
+    const auto slabs = static_cast<size_t>(
+        std::ceil(std::pow(static_cast<double>(leaves),
+                           1.0 / static_cast<double>(N - axis))));
+    const auto slab_size = kNodeSize * ((leaves + slabs - 1) / slabs);
+    const auto count = (size + slab_size - 1) / slab_size;
+
+    // The order of the items within a slab is irrelevant: the slabs are
+    // only partitioned, then processed in parallel.
+    partition(first, last, 0, count, slab_size, compare);
+    dispatch(
+        [&](const size_t start, const size_t end) {
+          for (auto ix = start; ix < end; ++ix) {
+            sort_tile_recursive(
+                items, first + static_cast<ptrdiff_t>(ix * slab_size),
+                first + static_cast<ptrdiff_t>(
+                            std::min((ix + 1) * slab_size, size)),
+                axis + 1);
+          }
+        },
+        count, 0);
+  }
+
+  // Partition the range [first, last) holding the slabs [begin, end) so
+  // that each slab holds the items it would hold if the range was sorted.
+  template <typename Compare>
+  static void partition(std::vector<uint32_t>::iterator first,
+                        std::vector<uint32_t>::iterator last,
+                        const size_t begin, const size_t end,
+                        const size_t slab_size, const Compare& compare) {
+    if (end - begin < 2) {
+      return;
+    }
+    const auto middle = begin + (end - begin) / 2;
+    const auto nth =
+        first + static_cast<ptrdiff_t>((middle - begin) * slab_size);
+    std::nth_element(first, nth, last, compare);
+    partition(first, nth, begin, middle, slab_size, compare);
+    partition(nth, last, middle, end, slab_size, compare);
+  }
+};
+
+}  // namespace gshhg
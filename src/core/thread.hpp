@@ -1,17 +1,317 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <thread>
+#include <utility>
 #include <vector>
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
 namespace gshhg {
 
+/// Persistent pool of threads executing parallel loops.
+///
+/// The range of a loop is divided into one slice per participating thread,
+/// the thread calling the loop being one of them. Each thread processes its
+/// slice chunk by chunk and, once its slice is exhausted, steals half of the
+/// remaining chunks of another slice. Cheap and expensive iterations are thus
+/// balanced between the threads, and the threads are created only once.
+class ThreadPool {
+ public:
+  /// Creates the pool
+  ///
+  /// @param size Number of worker threads.
+  explicit ThreadPool(const size_t size) {
+    workers_.reserve(size);
+    for (size_t ix = 0; ix < size; ++ix) {
+      workers_.emplace_back([this]() { run(); });
+    }
+  }
+
+  /// Stops and joins the worker threads
+  ~ThreadPool() {
+    {
+      auto lock = std::lock_guard<std::mutex>(mutex_);
+      stop_ = true;
+    }
+    ready_.notify_all();
+    for (auto& item : workers_) {
+      item.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  auto operator=(ThreadPool&&) -> ThreadPool& = delete;
+
+  /// Gets the pool shared by the whole process. It has one worker thread
+  /// less than the number of CPUs, the calling thread taking part in the
+  /// loops.
+  ///
+  /// A child process created by fork doesn't inherit the worker threads,
+  /// and the mutex of the pool may have been held by one of them: the pool
+  /// of the parent is abandoned in the child, which creates its own pool
+  /// on the next call.
+  static auto instance() -> ThreadPool& {
+    static const auto owner = Owner();
+    auto& current = Owner::current();
+    auto* pool = current.load(std::memory_order_acquire);
+    if (pool == nullptr) {
+      auto created = std::make_unique<ThreadPool>(
+          std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1);
+      // Another thread may have created the pool in the meantime.
+      if (current.compare_exchange_strong(pool, created.get(),
+                                          std::memory_order_acq_rel)) {
+        pool = created.release();
+      }
+    }
+    return *pool;
+  }
+
+  /// Gets the number of worker threads
+  [[nodiscard]] inline auto size() const noexcept -> size_t {
+    return workers_.size();
+  }
+
+  /// Executes a parallel loop.
+  ///
+  /// @param worker Function called with the bounds [start, end) of each
+  /// chunk of the range to process.
+  /// @param size Size of the range to process.
+  /// @param num_threads Maximum number of threads processing the range,
+  /// including the calling thread.
+  /// @throw The first exception thrown by the worker. The chunks not yet
+  /// started are then skipped.
+  template <typename Lambda>
+  void parallel_for(const Lambda& worker, const size_t size,
+                    const size_t num_threads) {
+    const auto participants = std::min({num_threads, workers_.size() + 1,
+                                        std::max<size_t>(size, 1)});
+    if (participants < 2) {
+      worker(0, size);
+      return;
+    }
+
+    auto job = Job(
+        [&worker](const size_t start, const size_t end) {
+          worker(start, end);
+        },
+        size, participants);
+    {
+      auto lock = std::lock_guard<std::mutex>(mutex_);
+      jobs_.push_back(&job);
+    }
+    ready_.notify_all();
+
+    // The calling thread processes the first slice.
+    job.run(0);
+
+    // The slices not claimed by a worker have been stolen: the job is
+    // withdrawn and the workers still processing it are awaited.
+    {
+      auto lock = std::unique_lock<std::mutex>(mutex_);
+      auto it = std::find(jobs_.begin(), jobs_.end(), &job);
+      if (it != jobs_.end()) {
+        jobs_.erase(it);
+      }
+      done_.wait(lock, [&job]() { return job.active == 0; });
+    }
+    if (job.exception != nullptr) {
+      std::rethrow_exception(job.exception);
+    }
+  }
+
+ private:
+  // Number of chunks per slice: the higher it is, the finer the balancing
+  // is.
+  static constexpr size_t kChunksPerSlice = 16;
+
+  // Part of the range remaining to be processed by a thread
+  struct Slice {
+    std::mutex mutex;
+    size_t begin{0};
+    size_t end{0};
+  };
+
+  // Parallel loop in progress
+  struct Job {
+    Job(std::function<void(size_t, size_t)> worker, const size_t size,
+        const size_t participants)
+        : worker(std::move(worker)),
+          slices(new Slice[participants]),
+          participants(participants),
+          grain(std::max<size_t>(size / (participants * kChunksPerSlice), 1)) {
+      for (size_t ix = 0; ix < participants; ++ix) {
+        slices[ix].begin = size * ix / participants;
+        slices[ix].end = size * (ix + 1) / participants;
+      }
+    }
+
+    // Process the chunks of a slice, then those stolen from the other
+    // slices.
+    void run(const size_t slice) {
+      while (auto chunk = pop(slice)) {
+        if (cancelled) {
+          continue;
+        }
+        try {
+          worker(chunk->first, chunk->second);
+        } catch (...) {
+          auto lock = std::lock_guard<std::mutex>(mutex);
+          if (exception == nullptr) {
+            exception = std::current_exception();
+          }
+          cancelled = true;
+        }
+      }
+    }
+
+    // Gets the next chunk to be processed by the thread owning the slice
+    auto pop(const size_t slice) -> std::optional<std::pair<size_t, size_t>> {
+      {
+        auto& item = slices[slice];
+        auto lock = std::lock_guard<std::mutex>(item.mutex);
+        if (item.begin < item.end) {
+          const auto begin = item.begin;
+          item.begin = std::min(begin + grain, item.end);
+          return std::make_pair(begin, item.begin);
+        }
+      }
+      return steal(slice);
+    }
+
+    // Moves the second half of the first non-empty slice found into the
+    // slice of the thief, and returns its first chunk.
+    auto steal(const size_t thief)
+        -> std::optional<std::pair<size_t, size_t>> {
+      for (size_t offset = 1; offset < participants; ++offset) {
+        auto& victim = slices[(thief + offset) % participants];
+        auto lock = std::unique_lock<std::mutex>(victim.mutex);
+        const auto remaining = victim.end - victim.begin;
+        if (remaining == 0) {
+          continue;
+        }
+        if (remaining <= grain) {
+          const auto begin = victim.begin;
+          victim.begin = victim.end;
+          return std::make_pair(begin, victim.end);
+        }
+        const auto middle = victim.begin + remaining / 2;
+        const auto end = victim.end;
+        victim.end = middle;
+        lock.unlock();
+
+        auto& item = slices[thief];
+        auto guard = std::lock_guard<std::mutex>(item.mutex);
+        item.begin = std::min(middle + grain, end);
+        item.end = end;
+        return std::make_pair(middle, item.begin);
+      }
+      return {};
+    }
+
+    std::function<void(size_t, size_t)> worker;
+    std::unique_ptr<Slice[]> slices;
+    size_t participants;
+    size_t grain;
+
+    // Next slice to be claimed by a worker and number of workers processing
+    // the job, protected by the mutex of the pool.
+    size_t next{1};
+    size_t active{0};
+
+    // First exception thrown by the worker
+    std::mutex mutex;
+    std::exception_ptr exception{nullptr};
+    std::atomic<bool> cancelled{false};
+  };
+
+  // Owner of the pool shared by the process, destroyed at exit.
+  struct Owner {
+    Owner() {
+      // The pointer to the pool is created first, to be destroyed last.
+      static_cast<void>(current());
+#ifndef _WIN32
+      // The handler only forgets the pool inherited from the parent: its
+      // threads don't exist in the child, so it can't be destroyed.
+      pthread_atfork(nullptr, nullptr, []() {
+        current().store(nullptr, std::memory_order_release);
+      });
+#endif
+    }
+
+    ~Owner() { delete current().load(std::memory_order_acquire); }
+
+    Owner(const Owner&) = delete;
+    auto operator=(const Owner&) -> Owner& = delete;
+    Owner(Owner&&) = delete;
+    auto operator=(Owner&&) -> Owner& = delete;
+
+    // Gets the pool shared by the process, null until it's created.
+    static auto current() -> std::atomic<ThreadPool*>& {
+      static auto result = std::atomic<ThreadPool*>(nullptr);
+      return result;
+    }
+  };
+
+  // Loop of the worker threads: claims a slice of the pending jobs.
+  void run() {
+    while (true) {
+      Job* job;
+      size_t slice;
+      {
+        auto lock = std::unique_lock<std::mutex>(mutex_);
+        ready_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+        if (stop_) {
+          return;
+        }
+        job = jobs_.front();
+        slice = job->next++;
+        ++job->active;
+        if (job->next == job->participants) {
+          jobs_.pop_front();
+        }
+      }
+      job->run(slice);
+      {
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        --job->active;
+      }
+      done_.notify_all();
+    }
+  }
+
+  std::vector<std::thread> workers_{};
+  std::deque<Job*> jobs_{};
+  std::mutex mutex_{};
+  std::condition_variable ready_{};
+  std::condition_variable done_{};
+  bool stop_{false};
+};
+
 /// Automates the cutting of vectors to be processed in thread.
 ///
-/// @param worker Lambda function called in each thread launched
+/// The range is processed by the threads of the process-wide pool, in chunks
+/// balanced between the threads. The worker is therefore called several times
+/// by each thread, with consecutive sub-ranges.
+///
+/// @param worker Lambda function called for each chunk of the range
 /// @param size Size of all vectors to be processed
 /// @param num_threads The number of threads to use for the computation. If 0
 /// all CPUs are used. If 1 is given, no parallel computing code is used at all,
 /// which is useful for debugging.
 /// @tparam Lambda Lambda function
+/// @throw The first exception thrown by the worker.
 template <typename Lambda>
 void dispatch(const Lambda& worker, size_t size, size_t num_threads) {
   if (num_threads == 1) {
@@ -22,24 +322,7 @@ void dispatch(const Lambda& worker, size_t size, size_t num_threads) {
   if (num_threads == 0) {
     num_threads = std::thread::hardware_concurrency();
   }
-
-  // List of threads responsible for parallelizing the calculation
-  std::vector<std::thread> threads(num_threads);
-
-  // Access index to the vectors required for calculation
-  size_t start = 0;
-  size_t shift = size / num_threads;
-
-  // Launch and join threads
-  for (auto it = std::begin(threads); it != std::end(threads) - 1; ++it) {
-    *it = std::thread(worker, start, start + shift);
-    start += shift;
-  }
-  threads.back() = std::thread(worker, start, size);
-
-  for (auto&& item : threads) {
-    item.join();
-  }
+  ThreadPool::instance().parallel_for(worker, size, num_threads);
 }
 
 }  // namespace gshhg
@@ -1,6 +1,10 @@
-from typing import Any, Callable, List, Optional, Tuple, Union
+from typing import (Any, Callable, Dict, Iterable, Iterator, List, Optional,
+                    Tuple, Union)
 import collections
+import concurrent.futures
 import pathlib
+import threading
+import weakref
 import dask.array
 import dask.array.core
 import numpy
@@ -42,43 +46,215 @@ class Vincenty(core.Vincenty):
         return Vincenty, (Spheroid(model.a, model.b), )
 
 
+def _stream(function: Callable,
+            blocks: Iterable[Tuple[numpy.ndarray, numpy.ndarray]],
+            prefetch: int) -> Iterator[Any]:
+    """Apply a query to a stream of blocks of coordinates.
+
+    A block is queried by a background thread, the query releasing the GIL,
+    while the next block is read from the iterator and the result of the
+    previous one is consumed: at most prefetch blocks, including the one
+    being read, are held.
+    """
+    if prefetch < 1:
+        raise ValueError("prefetch must be strictly positive")
+    iterator = iter(blocks)
+    with concurrent.futures.ThreadPoolExecutor(max_workers=1) as executor:
+        pending: collections.deque = collections.deque()
+        while True:
+            # The oldest result is returned before the next block is read.
+            if len(pending) == prefetch:
+                yield pending.popleft().result()
+            try:
+                lon, lat = next(iterator)
+            except StopIteration:
+                break
+            pending.append(executor.submit(function, lon, lat))
+            del lon, lat
+        while pending:
+            yield pending.popleft().result()
+
+
+# Selection of the shorelines: (dirname, resolution, levels, bbox,
+# grid_step, cache).
+_Selection = Tuple[str, Optional[str], Optional[Tuple[int, ...]],
+                   Optional[Tuple[float, float, float, float]],
+                   Optional[float], Optional[str]]
+
+# Maximum number of selections loaded by a process for its tasks: the least
+# recently used are released first.
+_MAX_INSTANCES = 4
+
+# Shorelines loaded for the tasks executed by the process, from the least
+# recently used selection to the most recently used one.
+_INSTANCES: "collections.OrderedDict[_Selection, core.GSHHG]" = \
+    collections.OrderedDict()
+
+# Instances created in the process, whose tasks query them instead of
+# loading the same selection again.
+_OWNERS: "weakref.WeakValueDictionary[_Selection, GSHHG]" = \
+    weakref.WeakValueDictionary()
+
+# Selections being loaded: the tasks requesting them wait for their loading
+# rather than loading them again.
+_LOADING: Dict[_Selection, concurrent.futures.Future] = {}
+
+# Protects the dictionaries above, not the loading of the shorelines.
+_INSTANCES_LOCK = threading.Lock()
+
+
+def _shared_instance(selection: _Selection) -> core.GSHHG:
+    """Get the shorelines selected, loaded once per process."""
+    with _INSTANCES_LOCK:
+        instance = _OWNERS.get(selection)
+        if instance is not None:
+            return instance
+        instance = _INSTANCES.get(selection)
+        if instance is not None:
+            _INSTANCES.move_to_end(selection)
+            return instance
+        future = _LOADING.get(selection)
+        if future is not None:
+            loading = False
+        else:
+            loading = True
+            future = _LOADING[selection] = concurrent.futures.Future()
+    if not loading:
+        return future.result()
+
+    # Only the tasks requesting the same selection wait for it.
+    dirname, resolution, levels, bbox, grid_step, cache = selection
+    try:
+        instance = core.GSHHG(dirname, resolution,
+                              None if levels is None else list(levels), bbox,
+                              grid_step, cache)
+    except BaseException as error:
+        with _INSTANCES_LOCK:
+            del _LOADING[selection]
+        future.set_exception(error)
+        raise
+    with _INSTANCES_LOCK:
+        del _LOADING[selection]
+        _INSTANCES[selection] = instance
+        while len(_INSTANCES) > _MAX_INSTANCES:
+            _INSTANCES.popitem(last=False)
+    future.set_result(instance)
+    return instance
+
+
 def _grid_mapping_mask(lon: numpy.array,
                        lat: numpy.array,
-                       dirname: Union[str, pathlib.Path],
-                       resolution: Optional[str],
-                       levels: Optional[List[int]],
-                       bbox: Tuple[float, float, float, float],
+                       selection: _Selection,
                        kwargs=None) -> numpy.ndarray:
     kwargs = kwargs or dict()
-    instance = core.GSHHG(dirname, resolution, levels, bbox=bbox)
-    mx, my = numpy.meshgrid(lon, lat)
-    return instance.mask(mx.flatten(), my.flatten(),
-                         **kwargs).reshape(mx.shape)
+    instance = _shared_instance(selection)
+    # The grid is rasterized from the origin of the chunk.
+    step = kwargs["spacing"]
+    return instance.rasterize_mask(lon[0],
+                                   lat[0],
+                                   step,
+                                   step,
+                                   len(lon),
+                                   len(lat),
+                                   num_threads=kwargs.get("num_threads", 0))
+
+
+# Lower bound, in meters, of the radii of curvature of the WGS84 ellipsoid:
+# two points separated by an angle θ, in radians, are at least θ * _MIN_RADIUS
+# apart.
+_MIN_RADIUS = 6.3e6
+
+
+def _halo_bbox(
+        lon: numpy.array, lat: numpy.array,
+        halo: float) -> Optional[Tuple[float, float, float, float]]:
+    """Get the bounding box containing all the points located at less than
+    the angle halo, in degrees, from the points of a grid, or None if it
+    covers the whole globe."""
+    y_min = max(lat[0] - halo, -90.0)
+    y_max = min(lat[-1] + halo, 90.0)
+    extent = max(abs(lat[0]), abs(lat[-1])) + halo
+    if extent < 90:
+        # Half width of the smallest circle of radius halo, located at the
+        # latitude farthest from the equator.
+        dlon = numpy.degrees(
+            numpy.arcsin(
+                numpy.sin(numpy.radians(halo)) /
+                numpy.cos(numpy.radians(max(abs(lat[0]), abs(lat[-1]))))))
+        x_min = lon[0] - dlon
+        x_max = lon[-1] + dlon
+        # A box crossing the antimeridian is extended to all the longitudes.
+        if x_min >= -180 and x_max <= 180:
+            return (x_min, y_min, x_max, y_max)
+    if y_min == -90 and y_max == 90:
+        return None
+    return (-180.0, y_min, 180.0, y_max)
 
 
 def _grid_mapping_distance_to_nearest(lon: numpy.array,
                                       lat: numpy.array,
-                                      dirname: Union[str, pathlib.Path],
-                                      resolution: Optional[str],
-                                      levels: Optional[List[int]],
-                                      bbox: Tuple[float, float, float, float],
+                                      selection: _Selection,
                                       kwargs=None) -> numpy.ndarray:
-    kwargs = kwargs or dict()
-    instance = core.GSHHG(dirname, resolution, levels, bbox=bbox)
-    mx, my = numpy.meshgrid(lon, lat)
-    return instance.distance_to_nearest(mx.flatten(), my.flatten(),
-                                        **kwargs).reshape(mx.shape)
+    # The dictionary is shared by the tasks of the graph.
+    kwargs = dict(kwargs or dict())
+    step = kwargs.pop("spacing")
+    halo = kwargs.pop("halo", None)
+    if halo is None:
+        # All the shorelines being indexed, the nearest coast of each point is
+        # found even if it is located outside the chunk. The distances are
+        # propagated over the grid from the coastlines.
+        instance = _shared_instance(selection)
+        return instance.rasterize_distance_to_nearest(lon[0], lat[0], step,
+                                                      step, len(lon),
+                                                      len(lat), **kwargs)
+    # Otherwise, the shorelines are loaded in a halo surrounding the chunk,
+    # doubled until the distances found are shorter than the halo. The coasts
+    # beyond it and the edges of the selection, which bound the polygons
+    # clipped, are then farther than the coasts found. The shorelines of the
+    # halo are shared like those of the whole selection: a halo covering the
+    # globe is the selection itself.
+    dirname, resolution, levels, _, _, cache = selection
+    while True:
+        bbox = _halo_bbox(lon, lat, halo)
+        instance = _shared_instance(selection if bbox is None else (
+            dirname, resolution, levels,
+            tuple(float(item) for item in bbox), None, cache))
+        if instance.points() != 0:
+            distance = instance.rasterize_distance_to_nearest(
+                lon[0], lat[0], step, step, len(lon), len(lat), **kwargs)
+            if bbox is None or distance.max() < numpy.radians(
+                    halo) * _MIN_RADIUS:
+                return distance
+        elif bbox is None:
+            raise IndexError("no coastline segment loaded")
+        halo *= 2
+
+
+def _grid_mapping_signed_distance(lon: numpy.array,
+                                  lat: numpy.array,
+                                  selection: _Selection,
+                                  kwargs=None) -> numpy.ndarray:
+    # The dictionary is shared by the tasks of the graph.
+    kwargs = dict(kwargs or dict())
+    instance = _shared_instance(selection)
+    step = kwargs.pop("spacing")
+    return instance.rasterize_signed_distance(lon[0], lat[0], step, step,
+                                              len(lon), len(lat), **kwargs)
 
 
 class GSHHG(core.GSHHG):
-    __slots__ = ("dirname", "resolution", "levels", "bbox")
+    # The instances of the extension support the weak references.
+    __slots__ = ("dirname", "resolution", "levels", "bbox", "grid_step",
+                 "cache")
 
     def __init__(
             self,
             dirname: Union[str, pathlib.Path],
             resolution: Optional[str] = None,
             levels: Optional[List[int]] = None,
-            bbox: Optional[Tuple[float, float, float, float]] = None) -> None:
+            bbox: Optional[Tuple[float, float, float, float]] = None,
+            grid_step: Optional[float] = None,
+            cache: Optional[Union[str, pathlib.Path]] = None) -> None:
         if isinstance(dirname, str):
             dirname = pathlib.Path(dirname)
         if not dirname.exists():
@@ -88,13 +264,34 @@ class GSHHG(core.GSHHG):
         if levels is not None and (min(levels) < 1 or max(levels) > 6):
             raise ValueError("values of the levels must be within [1, 6]")
         if bbox is not None:
-            bbox = (_normalize_longitude(bbox[0]), bbox[1],
-                    _normalize_longitude(bbox[2]), bbox[3])
-
-        super().__init__(str(dirname), resolution, levels, bbox)
-
-        (self.dirname, self.resolution, self.levels,
-         self.bbox) = (dirname, resolution, levels, bbox)
+            # A box whose western longitude is greater than its eastern one,
+            # once normalized, crosses the antimeridian.
+            if bbox[2] - bbox[0] >= 360:
+                bbox = (-180.0, bbox[1], 180.0, bbox[3])
+            else:
+                bbox = (_normalize_longitude(bbox[0]), bbox[1],
+                        _normalize_longitude(bbox[2]), bbox[3])
+
+        if cache is not None:
+            cache = str(cache)
+
+        super().__init__(str(dirname), resolution, levels, bbox, grid_step,
+                         cache)
+
+        (self.dirname, self.resolution, self.levels, self.bbox,
+         self.grid_step, self.cache) = (dirname, resolution, levels, bbox,
+                                        grid_step, cache)
+
+        # The tasks executed by this process query this instance.
+        with _INSTANCES_LOCK:
+            _OWNERS[self._selection()] = self
+
+    def _selection(self) -> _Selection:
+        """Get the selection of the shorelines loaded."""
+        return (str(self.dirname), self.resolution,
+                None if self.levels is None else tuple(self.levels),
+                None if self.bbox is None else tuple(self.bbox),
+                self.grid_step, self.cache)
 
     def to_svg(self,
                filename: Union[str, pathlib.Path],
@@ -108,15 +305,86 @@ class GSHHG(core.GSHHG):
                             lon: numpy.ndarray,
                             lat: numpy.ndarray,
                             strategy: Optional[str] = None,
-                            num_threads: int = 0):
+                            num_threads: int = 0,
+                            max_distance: Optional[float] = None):
         return super().distance_to_nearest(lon,
                                            lat,
                                            strategy=self._get_strategy(
                                                strategy or 'vincenty'),
-                                           num_threads=num_threads)
+                                           num_threads=num_threads,
+                                           max_distance=max_distance)
+
+    def within_distance(self,
+                        lon: numpy.ndarray,
+                        lat: numpy.ndarray,
+                        radius: float,
+                        strategy: Optional[str] = None,
+                        num_threads: int = 0) -> numpy.ndarray:
+        return super().within_distance(lon,
+                                       lat,
+                                       radius,
+                                       strategy=self._get_strategy(
+                                           strategy or 'vincenty'),
+                                       num_threads=num_threads)
+
+    def signed_distance(self,
+                        lon: numpy.ndarray,
+                        lat: numpy.ndarray,
+                        strategy: Optional[str] = None,
+                        land: Optional[List[int]] = None,
+                        num_threads: int = 0) -> numpy.ndarray:
+        return super().signed_distance(lon,
+                                       lat,
+                                       strategy=self._get_strategy(
+                                           strategy or 'vincenty'),
+                                       land=land,
+                                       num_threads=num_threads)
+
+    def classify(
+        self,
+        lon: numpy.ndarray,
+        lat: numpy.ndarray,
+        strategy: Optional[str] = None,
+        num_threads: int = 0
+    ) -> Tuple[numpy.ndarray, numpy.ndarray, numpy.ndarray, numpy.ndarray]:
+        return super().classify(lon,
+                                lat,
+                                strategy=self._get_strategy(strategy
+                                                            or 'vincenty'),
+                                num_threads=num_threads)
+
+    def iter_mask(self,
+                  blocks: Iterable[Tuple[numpy.ndarray, numpy.ndarray]],
+                  num_threads: int = 0,
+                  prefetch: int = 2) -> Iterator[numpy.ndarray]:
+        return _stream(
+            lambda lon, lat: self.mask(lon, lat, num_threads=num_threads),
+            blocks, prefetch)
+
+    def iter_nearest(
+            self,
+            blocks: Iterable[Tuple[numpy.ndarray, numpy.ndarray]],
+            num_threads: int = 0,
+            prefetch: int = 2
+    ) -> Iterator[Tuple[numpy.ndarray, numpy.ndarray]]:
+        return _stream(
+            lambda lon, lat: self.nearest(lon, lat, num_threads=num_threads),
+            blocks, prefetch)
+
+    def iter_distance_to_nearest(
+            self,
+            blocks: Iterable[Tuple[numpy.ndarray, numpy.ndarray]],
+            strategy: Optional[str] = None,
+            num_threads: int = 0,
+            prefetch: int = 2) -> Iterator[numpy.ndarray]:
+        return _stream(
+            lambda lon, lat: self.distance_to_nearest(
+                lon, lat, strategy=strategy, num_threads=num_threads),
+            blocks, prefetch)
 
     def __reduce__(self) -> Tuple[Any, ...]:
-        return GSHHG, (self.dirname, self.resolution, self.levels, self.bbox)
+        return GSHHG, (self.dirname, self.resolution, self.levels, self.bbox,
+                       self.grid_step, self.cache)
 
     @staticmethod
     def _dataset_template(
@@ -159,8 +427,12 @@ class GSHHG(core.GSHHG):
 
     def _lon_lat_arange(self, step: float) -> Tuple[numpy.array, numpy.array]:
         if self.bbox is not None:
+            # The longitudes of a box crossing the antimeridian exceed 180.
+            x_max = self.bbox[2]
+            if x_max < self.bbox[0]:
+                x_max += 360
             return numpy.arange(self.bbox[0],
-                                self.bbox[2] + step,
+                                x_max + step,
                                 step,
                                 dtype="float64"), numpy.arange(self.bbox[1],
                                                                self.bbox[3] +
@@ -202,21 +474,16 @@ class GSHHG(core.GSHHG):
 
         ychunks, xchunks = chunks
 
+        # The chunks query the shorelines loaded once by each process: the
+        # tasks only hold the selection of the shorelines.
+        selection = self._selection()
         dsk = {}
         for iy in range(len(ychunks)):
             y_slice = lat[sum(ychunks[0:iy]):sum(ychunks[0:iy + 1])]
-            y_max = max(y_slice[-1] + step, lat[-1])
-            y_min = min(y_slice[0] - step, lat[0])
-
             for ix in range(len(xchunks)):
                 x_slice = lon[sum(xchunks[0:ix]):sum(xchunks[0:ix + 1])]
-                x_max = max(x_slice[-1] + step, lon[-1])
-                x_min = min(x_slice[0] - step, lon[0])
-
                 dsk[(name, iy, ix)] = (function, x_slice, y_slice,
-                                       str(self.dirname), self.resolution,
-                                       self.levels, (x_min, y_min, x_max,
-                                                     y_max), kwargs)
+                                       selection, kwargs)
 
         return lon, lat, dask.array.Array(dsk, name, chunks, dtype)
 
@@ -229,7 +496,8 @@ class GSHHG(core.GSHHG):
                                            "grid_mapping_mask",
                                            step,
                                            blocksize,
-                                           num_threads=num_threads)
+                                           num_threads=num_threads,
+                                           spacing=step)
         coords, crs = self._dataset_template(lon, lat)
         data_vars = collections.OrderedDict(
             crs=crs,
@@ -264,7 +532,15 @@ class GSHHG(core.GSHHG):
             self,
             step: float,
             strategy: Optional[str] = None,
-            num_threads: int = 0) -> xarray.Dataset:
+            num_threads: int = 0,
+            blocksize: Optional[int] = None,
+            halo: Optional[float] = None) -> xarray.Dataset:
+        if halo is not None:
+            if halo <= 0:
+                raise ValueError("the halo must be strictly positive")
+            if self.bbox is not None:
+                raise ValueError(
+                    "the halo can't be combined with a bounding box")
         strategy = strategy or 'vincenty'
 
         lon, lat, array = self._dask_array(
@@ -272,11 +548,11 @@ class GSHHG(core.GSHHG):
             numpy.dtype("float64"),
             "grid_mapping_distance_to_nearest",
             step,
-            # Here it's not possible to run the calculation in different
-            # tasks.
-            blocksize=2**64 - 1,
+            blocksize,
             num_threads=num_threads,
-            strategy=self._get_strategy(strategy))
+            strategy=self._get_strategy(strategy),
+            spacing=step,
+            halo=halo)
         coords, crs = self._dataset_template(lon, lat)
         data_vars = collections.OrderedDict(
             crs=crs,
@@ -290,3 +566,37 @@ class GSHHG(core.GSHHG):
                     units="km")))
 
         return xarray.Dataset(data_vars=data_vars, coords=coords)
+
+    def grid_mapping_signed_distance(
+            self,
+            step: float,
+            strategy: Optional[str] = None,
+            land: Optional[List[int]] = None,
+            num_threads: int = 0,
+            blocksize: Optional[int] = None) -> xarray.Dataset:
+        strategy = strategy or 'vincenty'
+
+        lon, lat, array = self._dask_array(
+            _grid_mapping_signed_distance,
+            numpy.dtype("float64"),
+            "grid_mapping_signed_distance",
+            step,
+            blocksize,
+            num_threads=num_threads,
+            strategy=self._get_strategy(strategy),
+            land=land,
+            spacing=step)
+        coords, crs = self._dataset_template(lon, lat)
+        data_vars = collections.OrderedDict(
+            crs=crs,
+            distance=xarray.DataArray(
+                array * 1e-3,
+                dims=("lat", "lon"),
+                attrs=collections.OrderedDict(
+                    cell_methods="lat: point lon: point",
+                    coordinates="lat lon",
+                    long_name="signed distance to the nearest coastline, "
+                    "negative on land",
+                    units="km")))
+
+        return xarray.Dataset(data_vars=data_vars, coords=coords)
@@ -1,5 +1,9 @@
+import collections
+import concurrent.futures
+import gc
 import pathlib
 import pickle
+import threading
 import numpy as np
 import pytest
 try:
@@ -48,6 +52,126 @@ def test_construct():
         gshhg.GSHHG(get_dirname(), bbox=(0, ))
 
 
+def test_antimeridian():
+    instance = gshhg.GSHHG(get_dirname(), resolution="crude")
+    pacific = gshhg.GSHHG(get_dirname(),
+                          resolution="crude",
+                          bbox=(160, -50, 190, -10))
+    assert pacific.bbox == (160, -50, -170, -10)
+    assert 0 < pacific.polygons() < instance.polygons()
+
+    generator = np.random.default_rng(0)
+    lon = generator.uniform(160, 190, 10000)
+    lat = generator.uniform(-50, -10, 10000)
+    assert np.all(pacific.mask(lon, lat) == instance.mask(lon, lat))
+
+    # The nearest coasts of the points far from the edges of the box are
+    # loaded, on either side of the antimeridian.
+    lon = generator.uniform(170, 190, 10000)
+    lat = generator.uniform(-35, -25, 10000)
+    distance = instance.distance_to_nearest(lon, lat)
+    selected = distance < 400e3
+    assert np.count_nonzero(selected) != 0
+    assert np.allclose(
+        pacific.distance_to_nearest(lon, lat)[selected], distance[selected])
+
+    ds = pacific.grid_mapping_mask(0.5)
+    assert ds.lon.values[0] == 160 and ds.lon.values[-1] == 190
+
+
+def test_classify():
+    instance = gshhg.GSHHG(get_dirname(), resolution="crude")
+    generator = np.random.default_rng(0)
+    lon = generator.uniform(-180, 180, (100, 1000))
+    lat = generator.uniform(-90, 90, (100, 1000))
+
+    mask, x, y, distance = instance.classify(lon, lat, strategy="andoyer")
+    assert mask.shape == lon.shape
+    assert np.all(mask == instance.mask(lon, lat))
+    expected = instance.nearest(lon, lat)
+    assert np.all(x == expected[0])
+    assert np.all(y == expected[1])
+    assert np.allclose(distance,
+                       instance.distance_to_nearest(lon, lat, "andoyer"))
+
+
+def test_stream():
+    instance = gshhg.GSHHG(get_dirname(), resolution="crude")
+    generator = np.random.default_rng(0)
+    lon = generator.uniform(-180, 180, 100000)
+    lat = generator.uniform(-90, 90, 100000)
+
+    def blocks():
+        for ix in range(0, len(lon), 7000):
+            yield lon[ix:ix + 7000], lat[ix:ix + 7000]
+
+    mask = np.concatenate(list(instance.iter_mask(blocks())))
+    assert np.all(mask == instance.mask(lon, lat))
+
+    x, y = zip(*instance.iter_nearest(blocks(), prefetch=1))
+    expected = instance.nearest(lon, lat)
+    assert np.all(np.concatenate(x) == expected[0])
+    assert np.all(np.concatenate(y) == expected[1])
+
+    distance = np.concatenate(
+        list(instance.iter_distance_to_nearest(blocks(), strategy="andoyer")))
+    assert np.allclose(distance,
+                       instance.distance_to_nearest(lon, lat, "andoyer"))
+
+    # At most prefetch blocks are held: a block is read once the result of
+    # the oldest one has been returned.
+    for prefetch in [1, 2, 3]:
+        counts = collections.Counter()
+
+        def counted_blocks():
+            for item in blocks():
+                assert counts["read"] - counts["returned"] < prefetch
+                counts["read"] += 1
+                yield item
+
+        for _ in instance.iter_mask(counted_blocks(), prefetch=prefetch):
+            counts["returned"] += 1
+        assert counts["read"] == counts["returned"] == 15
+
+    assert list(instance.iter_mask(iter([]))) == []
+    with pytest.raises(ValueError):
+        next(instance.iter_mask(blocks(), prefetch=0))
+
+
+def test_cache(tmp_path):
+    instance = gshhg.GSHHG(get_dirname(), resolution="crude")
+
+    cached = gshhg.GSHHG(get_dirname(), resolution="crude", cache=tmp_path)
+    files = list(tmp_path.iterdir())
+    assert len(files) == 1
+
+    cached = gshhg.GSHHG(get_dirname(), resolution="crude", cache=tmp_path)
+    assert list(tmp_path.iterdir()) == files
+    assert cached.cache == str(tmp_path)
+    assert cached.polygons() == instance.polygons()
+    assert cached.points() == instance.points()
+
+    lon = np.random.uniform(-180.0, 180.0, 1000)
+    lat = np.random.uniform(-90.0, 90.0, 1000)
+    assert np.all(cached.mask(lon, lat) == instance.mask(lon, lat))
+    lon1, lat1 = cached.nearest(lon, lat)
+    lon2, lat2 = instance.nearest(lon, lat)
+    assert np.all(lon1 == lon2)
+    assert np.all(lat1 == lat2)
+
+    other = pickle.loads(pickle.dumps(cached))
+    assert other.cache == cached.cache
+    assert other.polygons() == cached.polygons()
+
+    # Another selection is stored in another file.
+    gshhg.GSHHG(get_dirname(),
+                resolution="crude",
+                levels=[1],
+                bbox=(-10, -20, 10, 20),
+                cache=tmp_path)
+    assert len(list(tmp_path.iterdir())) == 2
+
+
 def get_figure_path(path: str) -> pathlib.Path:
     dirname = pathlib.Path(__file__).absolute().parent.joinpath("figures")
     dirname.mkdir(exist_ok=True, parents=True)
@@ -77,6 +201,9 @@ def test_nearest():
     assert np.all(lon2 == lon3)
     assert np.all(lat2 == lat3)
 
+    # The nearest points are located on the coastline segments.
+    assert np.all(instance.distance_to_nearest(lon2, lat2) < 1)
+
 
 def test_distance_to_nearest():
     instance = gshhg.GSHHG(get_dirname(), resolution="crude")
@@ -101,6 +228,27 @@ def test_distance_to_nearest():
     assert np.all(d3 != d4)
 
 
+def test_within_distance():
+    instance = gshhg.GSHHG(get_dirname(), resolution="crude")
+    generator = np.random.default_rng(0)
+    lon = generator.uniform(-180, 180, 100000)
+    lat = generator.uniform(-90, 90, 100000)
+
+    distance = instance.distance_to_nearest(lon, lat, strategy="vincenty")
+    for radius in (1e3, 50e3, 500e3):
+        capped = instance.distance_to_nearest(lon,
+                                              lat,
+                                              strategy="vincenty",
+                                              max_distance=radius)
+        assert np.all(capped == np.minimum(distance, radius))
+        within = instance.within_distance(lon, lat, radius, "vincenty")
+        assert within.dtype == np.bool_
+        assert np.all(within == (distance <= radius))
+
+    with pytest.raises(ValueError):
+        instance.within_distance(lon, lat, -1)
+
+
 def test_mask():
     instance = gshhg.GSHHG(get_dirname(), resolution="crude")
 
@@ -114,6 +262,141 @@ def test_mask():
     assert np.all(mask1 == mask2)
     assert set(mask1) == set((0, 1, 2, 3, 5, 6))
 
+    lon = np.random.uniform(-180.0, 180.0, 100000)
+    lat = np.random.uniform(-90.0, 90.0, 100000)
+    mask1 = instance.mask(lon, lat)
+    for grid_step in [0.25, 1, 3.7]:
+        other = gshhg.GSHHG(get_dirname(),
+                            resolution="crude",
+                            grid_step=grid_step)
+        mask2 = other.mask(lon, lat)
+        assert np.all(mask1 == mask2)
+
+    with pytest.raises(ValueError):
+        gshhg.GSHHG(get_dirname(), resolution="crude", grid_step=0)
+
+
+def test_broadcast():
+    instance = gshhg.GSHHG(get_dirname(), resolution="crude")
+
+    lon = np.arange(-180, 180, 1, dtype=np.float64)
+    lat = np.arange(-90, 90, 1, dtype=np.float64)
+    mx, my = np.meshgrid(lon, lat)
+
+    # Coordinates broadcast together
+    mask = instance.mask(lon[np.newaxis, :], lat[:, np.newaxis])
+    assert mask.shape == mx.shape
+    assert np.all(mask == instance.mask(mx.flatten(), my.flatten()).reshape(
+        mx.shape))
+
+    # Strided coordinates
+    mask = instance.mask(mx[::2, ::3], my[::2, ::3])
+    assert np.all(mask == instance.mask(mx[::2, ::3].copy(),
+                                        my[::2, ::3].copy()))
+    mask = instance.mask(mx.T, my.T)
+    assert mask.shape == mx.T.shape
+
+    lon1, lat1 = instance.nearest(mx.T, my.T)
+    lon2, lat2 = instance.nearest(mx.flatten(), my.flatten())
+    assert lon1.shape == mx.T.shape
+    assert np.all(lon1.T.flatten() == lon2)
+    assert np.all(lat1.T.flatten() == lat2)
+
+    distance = instance.distance_to_nearest(lon[::-4], 45.0)
+    assert distance.shape == (90, )
+    assert np.all(distance == instance.distance_to_nearest(
+        lon[::-4].copy(), np.full((90, ), 45.0)))
+
+    with pytest.raises(ValueError):
+        instance.mask(lon, lat)
+
+
+def test_rasterize_mask():
+    instance = gshhg.GSHHG(get_dirname(), resolution="crude")
+
+    lon = np.arange(-180, 180, 0.5, dtype=np.float64)
+    lat = np.arange(-90, 90, 0.5, dtype=np.float64)
+    mask1 = instance.rasterize_mask(-180, -90, 0.5, 0.5, len(lon), len(lat))
+    mask2 = instance.mask(lon[np.newaxis, :], lat[:, np.newaxis])
+    assert mask1.shape == mask2.shape
+
+    # Only the points located on the edges of the polygons may differ.
+    assert np.count_nonzero(mask1 != mask2) < mask1.size * 1e-4
+
+    mask2 = instance.rasterize_mask(-180,
+                                    -90,
+                                    0.5,
+                                    0.5,
+                                    len(lon),
+                                    len(lat),
+                                    num_threads=1)
+    assert np.all(mask1 == mask2)
+
+    with pytest.raises(ValueError):
+        instance.rasterize_mask(-180, -90, 0, 0.5, len(lon), len(lat))
+
+
+def test_rasterize_distance_to_nearest():
+    instance = gshhg.GSHHG(get_dirname(), resolution="crude")
+    strategy = gshhg.Andoyer()
+
+    lon = np.arange(-180, 180, 1, dtype=np.float64)
+    lat = np.arange(-90, 90, 1, dtype=np.float64)
+    distance1 = instance.rasterize_distance_to_nearest(
+        -180, -90, 1, 1, len(lon), len(lat), strategy)
+    distance2 = instance.distance_to_nearest(lon[np.newaxis, :],
+                                             lat[:, np.newaxis], strategy)
+    assert distance1.shape == distance2.shape
+    assert np.allclose(distance1, distance2)
+
+    # Without the exact search, some distances are overestimated. The nearest
+    # segments being compared in ECEF, a few others differ by some meters.
+    distance3 = instance.rasterize_distance_to_nearest(-180,
+                                                       -90,
+                                                       1,
+                                                       1,
+                                                       len(lon),
+                                                       len(lat),
+                                                       strategy,
+                                                       exact=False)
+    assert np.all(distance3 >= distance2 - 100)
+    assert np.count_nonzero(distance3 > distance2 + 1) < distance3.size * 0.25
+
+    with pytest.raises(ValueError):
+        instance.rasterize_distance_to_nearest(-180, -90, 1, 0, len(lon),
+                                               len(lat), strategy)
+
+
+def test_signed_distance():
+    instance = gshhg.GSHHG(get_dirname(), resolution="crude")
+    generator = np.random.default_rng(0)
+    lon = generator.uniform(-180, 180, 100000)
+    lat = generator.uniform(-90, 90, 100000)
+
+    mask = instance.mask(lon, lat)
+    distance = instance.distance_to_nearest(lon, lat, "andoyer")
+    signed = instance.signed_distance(lon, lat, "andoyer")
+    assert np.allclose(signed, np.where(mask != 0, -distance, distance))
+
+    # The lakes and the ponds are water.
+    signed = instance.signed_distance(lon, lat, "andoyer", land=[1, 3, 5, 6])
+    land = (mask != 0) & (mask != 2) & (mask != 4)
+    assert np.count_nonzero(mask == 2) != 0
+    assert np.allclose(signed, np.where(land, -distance, distance))
+
+    with pytest.raises(ValueError):
+        instance.signed_distance(lon, lat, land=[0])
+
+    # On a grid, the sign is given by the mask of the grid.
+    ds = instance.grid_mapping_signed_distance(2, strategy="andoyer")
+    mask = instance.rasterize_mask(-180, -90, 2, 2, len(ds.lon), len(ds.lat))
+    distance = instance.rasterize_distance_to_nearest(-180, -90, 2, 2,
+                                                      len(ds.lon),
+                                                      len(ds.lat),
+                                                      gshhg.Andoyer())
+    assert np.allclose(ds.distance.values,
+                       np.where(mask != 0, -distance, distance) * 1e-3)
+
 
 def test_grid_mapping_mask():
     instance = gshhg.GSHHG(get_dirname(), resolution="crude")
@@ -130,7 +413,87 @@ def test_grid_mapping_mask():
                        pad_inches=0.4)
 
 
-def test_grid_mapping_distance_to_nearest():
+def test_shared_instance(monkeypatch):
+    loads = []
+    load = gshhg.core.GSHHG
+
+    def counting_load(*args, **kwargs):
+        loads.append(args)
+        return load(*args, **kwargs)
+
+    monkeypatch.setattr(gshhg.core, "GSHHG", counting_load)
+    monkeypatch.setattr(gshhg, "_INSTANCES", collections.OrderedDict())
+
+    # The tasks executed by the process query the instance created.
+    instance = gshhg.GSHHG(get_dirname(),
+                           resolution="crude",
+                           bbox=(-30, 20, 30, 60))
+    ds = instance.grid_mapping_mask(1, blocksize=10)
+    assert len(ds.mask.chunks[0]) > 1
+    ds.mask.values
+    assert not loads
+    selection = instance._selection()
+    assert gshhg._shared_instance(selection) is instance
+
+    # Once the instance is released, the selection, bounding box included,
+    # is loaded once.
+    del instance, ds
+    gc.collect()
+    shared = gshhg._shared_instance(selection)
+    assert gshhg._shared_instance(selection) is shared
+    assert len(loads) == 1
+    assert loads[0][3] == (-30, 20, 30, 60)
+
+    # The least recently used selections are released.
+    for ix in range(gshhg._MAX_INSTANCES):
+        gshhg._shared_instance(selection[:3] + ((-30, 21 + ix, 30, 60), ) +
+                               selection[4:])
+    assert len(loads) == gshhg._MAX_INSTANCES + 1
+    assert len(gshhg._INSTANCES) == gshhg._MAX_INSTANCES
+    assert selection not in gshhg._INSTANCES
+
+
+def test_shared_instance_loading(monkeypatch):
+    load = gshhg.core.GSHHG
+    loads = []
+    started = threading.Event()
+    release = threading.Event()
+    dirname = str(get_dirname())
+    slow = (dirname, "crude", None, (-30, 20, 30, 60), None, None)
+    fast = (dirname, "crude", None, (-10, 40, 10, 50), None, None)
+
+    def blocking_load(*args, **kwargs):
+        loads.append(args)
+        if args[3] == slow[3]:
+            started.set()
+            assert release.wait(60)
+        return load(*args, **kwargs)
+
+    monkeypatch.setattr(gshhg.core, "GSHHG", blocking_load)
+    monkeypatch.setattr(gshhg, "_INSTANCES", collections.OrderedDict())
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=2) as executor:
+        first = executor.submit(gshhg._shared_instance, slow)
+        assert started.wait(60)
+        second = executor.submit(gshhg._shared_instance, slow)
+        # Another selection is loaded while the first one is being loaded,
+        # whose requests wait for it.
+        gshhg._shared_instance(fast)
+        assert not first.done() and not second.done()
+        release.set()
+        assert first.result() is second.result()
+    assert len(loads) == 2
+
+    # A failed load is reported to the tasks, and tried again.
+    monkeypatch.setattr(gshhg.core, "GSHHG", load)
+    missing = ("/nonexistent", ) + slow[1:]
+    for _ in range(2):
+        with pytest.raises(RuntimeError):
+            gshhg._shared_instance(missing)
+    assert not gshhg._LOADING
+
+
+def test_grid_mapping_distance_to_nearest(monkeypatch):
     instance = gshhg.GSHHG(get_dirname(), resolution="crude")
     ds = instance.grid_mapping_distance_to_nearest(0.25)
     array = ds.distance.data.compute()
@@ -143,3 +506,63 @@ def test_grid_mapping_distance_to_nearest():
         figure.savefig(get_figure_path("distance_to_nearest.png"),
                        bbox_inches='tight',
                        pad_inches=0.4)
+
+    # The nearest coasts of the chunks may be outside them.
+    ds = instance.grid_mapping_distance_to_nearest(2,
+                                                   strategy="andoyer",
+                                                   blocksize=30)
+    assert len(ds.distance.chunks[0]) > 1
+    expected = instance.distance_to_nearest(ds.lon.values[np.newaxis, :],
+                                            ds.lat.values[:, np.newaxis],
+                                            strategy="andoyer")
+    assert np.allclose(ds.distance.values, expected * 1e-3)
+
+    # The chunks load the shorelines around them.
+    ds = instance.grid_mapping_distance_to_nearest(2,
+                                                   strategy="andoyer",
+                                                   blocksize=30,
+                                                   halo=2)
+    assert len(ds.distance.chunks[0]) > 1
+    assert np.allclose(ds.distance.values, expected * 1e-3)
+
+    # The shorelines of the halos are shared: a chunk computed twice loads
+    # its halo once, and a halo covering the globe is the instance itself.
+    loads = []
+    load = gshhg.core.GSHHG
+
+    def counting_load(*args, **kwargs):
+        loads.append(args)
+        return load(*args, **kwargs)
+
+    monkeypatch.setattr(gshhg.core, "GSHHG", counting_load)
+    monkeypatch.setattr(gshhg, "_INSTANCES", collections.OrderedDict())
+    selection = instance._selection()
+    lon = np.arange(-10, 10, 2.0)
+    lat = np.arange(40, 60, 2.0)
+    for _ in range(2):
+        distance = gshhg._grid_mapping_distance_to_nearest(
+            lon, lat, selection,
+            dict(spacing=2.0,
+                 halo=2.0,
+                 strategy=instance._get_strategy("andoyer")))
+    assert len(loads) >= 1
+    assert len(set(loads)) == len(loads)
+    assert np.allclose(
+        distance,
+        instance.distance_to_nearest(lon[np.newaxis, :],
+                                     lat[:, np.newaxis],
+                                     strategy="andoyer"))
+    loads.clear()
+    ds = instance.grid_mapping_distance_to_nearest(2,
+                                                   strategy="andoyer",
+                                                   blocksize=30,
+                                                   halo=180)
+    assert np.allclose(ds.distance.values, expected * 1e-3)
+    assert not loads
+
+    with pytest.raises(ValueError):
+        instance.grid_mapping_distance_to_nearest(2, halo=0)
+    with pytest.raises(ValueError):
+        gshhg.GSHHG(get_dirname(), resolution="crude",
+                    bbox=(-10, 40, 10, 60)).grid_mapping_distance_to_nearest(
+                        2, halo=2)
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gshhg.hpp"
+#include "internals.hpp"
+
+namespace gshhg {
+
+namespace fs = std::filesystem;
+
+// Temporary directory removed at the end of each test
+class Cache : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = fs::temp_directory_path() /
+                 ("gshhg_test_" + std::to_string(std::random_device()()));
+    fs::create_directories(directory_);
+  }
+
+  void TearDown() override {
+    fs::permissions(directory_, fs::perms::owner_all,
+                    fs::perm_options::add);
+    fs::remove_all(directory_);
+  }
+
+  // Gets the only cache file written in the directory
+  auto cache_file() const -> fs::path {
+    auto result = std::vector<fs::path>();
+    for (const auto& item : fs::directory_iterator(directory_)) {
+      result.push_back(item.path());
+    }
+    EXPECT_EQ(result.size(), 1);
+    return result.empty() ? fs::path() : result[0];
+  }
+
+  fs::path directory_;
+};
+
+// Loads the crude shorelines located in a bounding box
+static auto load(const std::optional<std::string>& cache) -> GSHHG {
+  return {data_directory(), std::string("crude"), {},
+          Box({-20, 30}, {40, 70}), std::nullopt, cache};
+}
+
+// Gets the mask of the points of a regular grid
+static auto mask(const GSHHG& instance) -> std::vector<uint8_t> {
+  auto result = std::vector<uint8_t>();
+  for (auto lat = 30.0; lat <= 70; lat += 0.5) {
+    for (auto lon = -20.0; lon <= 40; lon += 0.5) {
+      result.push_back(instance.mask(lon, lat));
+    }
+  }
+  return result;
+}
+
+// If the cache file can't be written, the shorelines read from the
+// shapefiles are used.
+TEST_F(Cache, ReadOnly) {
+  const auto expected = mask(load(std::nullopt));
+
+  // The permissions are not enforced for the superuser.
+  const auto readonly = directory_ / "readonly";
+  fs::create_directories(readonly);
+  fs::permissions(readonly, fs::perms::owner_read | fs::perms::owner_exec);
+  const auto instance = load(readonly.string());
+  EXPECT_EQ(mask(instance), expected);
+  fs::permissions(readonly, fs::perms::owner_all);
+
+  // The cache directory can't be created under a regular file.
+  const auto file = directory_ / "file";
+  std::ofstream(file).put('\0');
+  EXPECT_EQ(mask(load((file / "cache").string())), expected);
+  EXPECT_TRUE(fs::is_regular_file(file));
+}
+
+// Overwrites a value stored in a file
+template <typename T>
+static auto overwrite(const fs::path& path, const int64_t offset,
+                      const T& value) -> void {
+  auto stream = std::fstream(path, std::ios::binary | std::ios::in |
+                                       std::ios::out);
+  stream.seekp(offset);
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Gets the offset in the mapped file of an array of the cache.
+template <typename T>
+static auto offset(const GSHHG& instance, const Buffer<T>& buffer)
+    -> int64_t {
+  return reinterpret_cast<const char*>(buffer.data()) -
+         GSHHGInternals::file(instance)->data();
+}
+
+// A truncated cache file is ignored, then rewritten.
+TEST_F(Cache, Truncated) {
+  const auto expected = mask(load(std::nullopt));
+  ASSERT_EQ(GSHHGInternals::file(load(directory_.string())), nullptr);
+  const auto path = cache_file();
+  const auto size = fs::file_size(path);
+  ASSERT_NE(GSHHGInternals::file(load(directory_.string())), nullptr);
+
+  for (const auto length : {size / 2, size - 1, uint64_t(10)}) {
+    fs::resize_file(path, length);
+    const auto instance = load(directory_.string());
+    EXPECT_EQ(GSHHGInternals::file(instance), nullptr);
+    EXPECT_EQ(mask(instance), expected);
+    EXPECT_EQ(fs::file_size(cache_file()), size);
+    EXPECT_EQ(mask(load(directory_.string())), expected);
+  }
+}
+
+// A cache file whose R-trees reference entries out of range is ignored,
+// then rewritten.
+TEST_F(Cache, Corrupted) {
+  const auto expected = mask(load(std::nullopt));
+  static_cast<void>(load(directory_.string()));
+  const auto path = cache_file();
+
+  // Offsets, in the file, of the root of the segment R-tree, of a leaf of
+  // the polygon R-tree and of the offset of the last polygon.
+  auto root = int64_t(0);
+  auto leaf = int64_t(0);
+  auto last = int64_t(0);
+  auto polygons = uint32_t(0);
+  {
+    const auto instance = load(directory_.string());
+    ASSERT_NE(GSHHGInternals::file(instance), nullptr);
+    const auto& rtree = GSHHGInternals::rtree(instance);
+    root = offset(instance, rtree.indices()) +
+           static_cast<int64_t>(sizeof(uint32_t) * rtree.indices().size()) -
+           static_cast<int64_t>(sizeof(uint32_t));
+    leaf = offset(instance, GSHHGInternals::polygon_rtree(instance).indices());
+    polygons = static_cast<uint32_t>(instance.polygons());
+    last = offset(instance, GSHHGInternals::offsets(instance)) +
+           static_cast<int64_t>(sizeof(uint64_t) * (polygons - 1));
+  }
+
+  auto check = [&]() -> void {
+    const auto instance = load(directory_.string());
+    EXPECT_EQ(GSHHGInternals::file(instance), nullptr);
+    EXPECT_EQ(mask(instance), expected);
+    const auto reloaded = load(directory_.string());
+    EXPECT_NE(GSHHGInternals::file(reloaded), nullptr);
+    EXPECT_EQ(mask(reloaded), expected);
+  };
+
+  overwrite(path, root, std::numeric_limits<uint32_t>::max());
+  check();
+  overwrite(path, leaf, polygons);
+  check();
+  overwrite(path, last, std::numeric_limits<uint64_t>::max());
+  check();
+}
+
+}  // namespace gshhg
@@ -0,0 +1,330 @@
+#include "geometry.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "internals.hpp"
+
+namespace gshhg {
+
+// Gets geodetic coordinates, in radians: random points and the particular
+// points of the globe (poles, equator, meridians 0 and ±180).
+static auto coordinates(const size_t size)
+    -> std::pair<std::vector<double>, std::vector<double>> {
+  auto generator = std::mt19937_64(size);
+  auto lon = std::uniform_real_distribution<double>(-pi<double>(),
+                                                     pi<double>());
+  auto lat = std::uniform_real_distribution<double>(-pi_2<double>(),
+                                                     pi_2<double>());
+  auto result = std::make_pair(std::vector<double>(size),
+                               std::vector<double>(size));
+  const double particular[][2] = {
+      {0, 0},
+      {pi<double>(), 0},
+      {-pi<double>(), 0},
+      {0, pi_2<double>()},
+      {0, -pi_2<double>()},
+      {pi_2<double>(), pi_2<double>() / 2},
+      {-pi_2<double>(), -pi_2<double>() / 2}};
+  for (size_t ix = 0; ix < size; ++ix) {
+    if (ix < std::size(particular)) {
+      result.first[ix] = particular[ix][0];
+      result.second[ix] = particular[ix][1];
+    } else {
+      result.first[ix] = lon(generator);
+      result.second[ix] = lat(generator);
+    }
+  }
+  return result;
+}
+
+// The batch conversions, vectorized, give the same values as the scalar
+// ones, including for the elements of the remainder of the vectorized loop.
+TEST(Geometry, BatchGeodeticToCartesian) {
+  for (const size_t size : {0, 1, 3, 7, 8, 9, 17, 1001}) {
+    const auto [lon, lat] = coordinates(size);
+    auto x = std::vector<double>(size);
+    auto y = std::vector<double>(size);
+    auto z = std::vector<double>(size);
+    geodetic_2_cartesian(lon.data(), lat.data(), size, x.data(), y.data(),
+                         z.data());
+    for (size_t ix = 0; ix < size; ++ix) {
+      const auto expected = geodetic_2_cartesian(
+          GeodeticRadian(lon[ix], lat[ix]));
+      EXPECT_EQ(x[ix], expected.get<0>());
+      EXPECT_EQ(y[ix], expected.get<1>());
+      EXPECT_EQ(z[ix], expected.get<2>());
+    }
+  }
+}
+
+TEST(Geometry, BatchCartesianToGeodetic) {
+  for (const size_t size : {0, 1, 3, 7, 8, 9, 17, 1001}) {
+    const auto [lon, lat] = coordinates(size);
+    auto x = std::vector<double>(size);
+    auto y = std::vector<double>(size);
+    auto z = std::vector<double>(size);
+    geodetic_2_cartesian(lon.data(), lat.data(), size, x.data(), y.data(),
+                         z.data());
+    auto lon1 = std::vector<double>(size);
+    auto lat1 = std::vector<double>(size);
+    cartesian_2_geodetic(x.data(), y.data(), z.data(), size, lon1.data(),
+                         lat1.data());
+    for (size_t ix = 0; ix < size; ++ix) {
+      const auto expected =
+          cartesian_2_geodetic(Cartesian(x[ix], y[ix], z[ix]));
+      EXPECT_EQ(lon1[ix], expected.get<0>());
+      EXPECT_EQ(lat1[ix], expected.get<1>());
+    }
+  }
+}
+
+// The conversions agree with the formulas evaluated by the standard library
+// and the round trip restores the coordinates.
+TEST(Geometry, Accuracy) {
+  constexpr double kA = 6378137;
+  constexpr double kB = 6356752.3142;
+  const auto e2 = (kA * kA - kB * kB) / (kA * kA);
+  const auto [lon, lat] = coordinates(10000);
+  for (size_t ix = 0; ix < lon.size(); ++ix) {
+    const auto point = geodetic_2_cartesian(GeodeticRadian(lon[ix], lat[ix]));
+    const auto n = kA / std::sqrt(1 - e2 * std::sin(lat[ix]) *
+                                          std::sin(lat[ix]));
+    EXPECT_NEAR(point.get<0>(), n * std::cos(lat[ix]) * std::cos(lon[ix]),
+                1e-8);
+    EXPECT_NEAR(point.get<1>(), n * std::cos(lat[ix]) * std::sin(lon[ix]),
+                1e-8);
+    EXPECT_NEAR(point.get<2>(), n * (1 - e2) * std::sin(lat[ix]), 1e-8);
+
+    const auto geodetic = cartesian_2_geodetic(point);
+    EXPECT_NEAR(geodetic.get<1>(), lat[ix], 1e-12);
+    // The longitude of the poles is undefined.
+    if (std::fabs(lat[ix]) != pi_2<double>()) {
+      EXPECT_NEAR(std::remainder(geodetic.get<0>() - lon[ix],
+                                 two_pi<double>()),
+                  0, 1e-12);
+    }
+  }
+}
+
+// Gets the number of representable doubles between two values.
+static auto ulps(const double a, const double b) -> uint64_t {
+  auto ordered = [](const double value) -> int64_t {
+    auto bits = int64_t(0);
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits < 0 ? std::numeric_limits<int64_t>::min() - bits : bits;
+  };
+  const auto ia = ordered(a);
+  const auto ib = ordered(b);
+  return ia > ib ? static_cast<uint64_t>(ia) - static_cast<uint64_t>(ib)
+                 : static_cast<uint64_t>(ib) - static_cast<uint64_t>(ia);
+}
+
+// Gets the angles tested: random angles in [-limit, limit] and the angles
+// close to the multiples of π/2 of this interval.
+static auto angles(const double limit, const size_t size)
+    -> std::vector<double> {
+  auto generator = std::mt19937_64(size);
+  auto angle = std::uniform_real_distribution<double>(-limit, limit);
+  auto result = std::vector<double>();
+  for (size_t ix = 0; ix < size; ++ix) {
+    result.push_back(angle(generator));
+  }
+  for (auto k = -std::floor(limit / pi_2<double>());
+       k * pi_2<double>() <= limit; ++k) {
+    auto x = k * pi_2<double>();
+    for (auto ix = 0; ix < 8; ++ix) {
+      x = std::nextafter(x, -limit);
+    }
+    for (auto ix = 0; ix < 16; ++ix) {
+      result.push_back(x);
+      x = std::nextafter(x, limit);
+    }
+  }
+  return result;
+}
+
+// The approximations of the sine and the cosine are within two ulps of the
+// standard library over the range of the longitudes and latitudes,
+// including near ±π/2 and ±π. The cosine close to ±π/2 is compared in
+// absolute value, its ulp being meaningless once the angle is rounded.
+TEST(Geometry, SinCos) {
+  for (const auto& [limit, size] :
+       {std::make_pair(pi<double>(), size_t(1000000)),
+        std::make_pair(1e5 - 1, size_t(100000))}) {
+    for (const auto x : angles(limit, size)) {
+      double sin, cos;
+      fast_sin_cos(x, sin, cos);
+      for (const auto& [value, expected] :
+           {std::make_pair(sin, std::sin(x)),
+            std::make_pair(cos, std::cos(x))}) {
+        if (std::fabs(expected) < 1e-8) {
+          EXPECT_NEAR(value, expected, 1e-22) << x;
+        } else {
+          EXPECT_LE(ulps(value, expected), 2) << x;
+        }
+      }
+    }
+  }
+  // Out of the domain of the approximations, the standard library is used.
+  for (const auto x : {1e5, -1e5, 1e6, 1e300, -1e300}) {
+    double sin, cos;
+    fast_sin_cos(x, sin, cos);
+    EXPECT_EQ(sin, std::sin(x));
+    EXPECT_EQ(cos, std::cos(x));
+  }
+}
+
+// The approximation of the arc tangent is within one ulp of the standard
+// library in the four quadrants.
+TEST(Geometry, Atan2) {
+  auto generator = std::mt19937_64(0);
+  auto value = std::uniform_real_distribution<double>(-1, 1);
+  auto exponent = std::uniform_int_distribution<int>(-20, 20);
+  for (size_t ix = 0; ix < 1000000; ++ix) {
+    const auto y = std::ldexp(value(generator), exponent(generator));
+    const auto x = std::ldexp(value(generator), exponent(generator));
+    EXPECT_LE(ulps(fast_atan2(y, x), std::atan2(y, x)), 1) << y << " " << x;
+  }
+  for (const auto y : {-1.0, -0.0, 0.0, 1.0}) {
+    for (const auto x : {-1.0, 0.0, 1.0}) {
+      EXPECT_LE(ulps(fast_atan2(y, x), std::atan2(y, x)), 1) << y << " " << x;
+    }
+  }
+}
+
+// The points whose angles are out of the domain of the approximations are
+// converted by the standard library, by the scalar and batch functions.
+TEST(Geometry, LargeAngles) {
+  const auto lon = std::vector<double>{1e6, -3e5, 0.5, 1e300, 2.0, 0.1,
+                                       0.2, 0.3, 0.4};
+  const auto lat = std::vector<double>{0.5, 1.0, 2e5, 0.2, -1e7, 0.1,
+                                       0.2, 0.3, 0.4};
+  const auto size = lon.size();
+  auto x = std::vector<double>(size);
+  auto y = std::vector<double>(size);
+  auto z = std::vector<double>(size);
+  geodetic_2_cartesian(lon.data(), lat.data(), size, x.data(), y.data(),
+                       z.data());
+  constexpr double kA = 6378137;
+  constexpr double kB = 6356752.3142;
+  const auto e2 = (kA * kA - kB * kB) / (kA * kA);
+  for (size_t ix = 0; ix < size; ++ix) {
+    const auto expected =
+        geodetic_2_cartesian(GeodeticRadian(lon[ix], lat[ix]));
+    EXPECT_EQ(x[ix], expected.get<0>());
+    EXPECT_EQ(y[ix], expected.get<1>());
+    EXPECT_EQ(z[ix], expected.get<2>());
+    const auto n = kA / std::sqrt(1 - e2 * std::sin(lat[ix]) *
+                                          std::sin(lat[ix]));
+    EXPECT_NEAR(x[ix], n * std::cos(lat[ix]) * std::cos(lon[ix]), 1e-8);
+    EXPECT_NEAR(y[ix], n * std::cos(lat[ix]) * std::sin(lon[ix]), 1e-8);
+    EXPECT_NEAR(z[ix], n * (1 - e2) * std::sin(lat[ix]), 1e-8);
+  }
+}
+
+// Reference implementation of the crossing-number test, one edge at a time:
+// an edge is crossed if its end points are on either side of the ray, an end
+// point located on the ray being below it. A point located on an edge
+// crosses it if the edge goes downward.
+static auto reference(const std::vector<double>& x,
+                      const std::vector<double>& y, const double px,
+                      const double py) -> bool {
+  auto result = false;
+  for (size_t ix = 0; ix + 1 < x.size(); ++ix) {
+    if ((y[ix] > py) == (y[ix + 1] > py)) {
+      continue;
+    }
+    const auto cross = (px - x[ix]) * (y[ix + 1] - y[ix]) -
+                       (py - y[ix]) * (x[ix + 1] - x[ix]);
+    if (y[ix + 1] > y[ix] ? cross < 0 : cross >= 0) {
+      result = !result;
+    }
+  }
+  return result;
+}
+
+// The crossing-number kernel agrees with Boost.Geometry for the points that
+// are not on the boundary of the polygon, including those whose ray goes
+// through a vertex, and with the reference implementation for the vertices.
+// The number of edges covers the vectorized part of the loop and its
+// remainder.
+TEST(Geometry, OddCrossings) {
+  auto generator = std::mt19937_64(0);
+  auto sizes = std::vector<size_t>();
+  for (size_t size = 3; size <= 80; ++size) {
+    sizes.push_back(size);
+  }
+  sizes.push_back(257);
+  sizes.push_back(1000);
+  for (const auto size : sizes) {
+    const auto polygon = star_polygon(size, generator);
+    const auto& ring = polygon.outer();
+    auto x = std::vector<double>();
+    auto y = std::vector<double>();
+    for (const auto& item : ring) {
+      x.push_back(item.get<0>());
+      y.push_back(item.get<1>());
+    }
+    const auto edges = x.size() - 1;
+    const auto x1 = std::vector<double>(x.begin() + 1, x.end());
+    const auto y1 = std::vector<double>(y.begin() + 1, y.end());
+    auto kernel = [&](const double px, const double py) -> bool {
+      const auto result =
+          odd_crossings(x.data(), y.data(), edges, px, py);
+      // The variant processing disjoint edges gives the same result.
+      EXPECT_EQ(odd_crossings(x.data(), y.data(), x1.data(), y1.data(), edges,
+                              px, py),
+                result);
+      return result;
+    };
+
+    // Random points in the envelope of the polygon
+    const auto envelope = boost::geometry::return_envelope<Box>(polygon);
+    auto lon = std::uniform_real_distribution<double>(
+        envelope.min_corner().get<0>() - 1, envelope.max_corner().get<0>() + 1);
+    auto lat = std::uniform_real_distribution<double>(
+        envelope.min_corner().get<1>() - 1, envelope.max_corner().get<1>() + 1);
+    for (size_t ix = 0; ix < 200; ++ix) {
+      const auto point = Point(lon(generator), lat(generator));
+      EXPECT_EQ(kernel(point.get<0>(), point.get<1>()),
+                boost::geometry::within(point, polygon));
+    }
+
+    // Vertices, and points close to the vertices on each side of the edges
+    for (size_t ix = 0; ix < edges; ++ix) {
+      const auto px = x[ix];
+      const auto py = y[ix];
+      EXPECT_TRUE(boost::geometry::intersects(Point(px, py), polygon));
+      EXPECT_EQ(kernel(px, py), reference(x, y, px, py));
+      // The ray leaving points located at the latitude of the vertex goes
+      // through it.
+      for (const auto dx : {-5.0, -0.5, 0.5}) {
+        const auto point = Point(px + dx, py);
+        if (!boost::geometry::intersects(point, polygon)) {
+          EXPECT_FALSE(kernel(point.get<0>(), point.get<1>()));
+        } else if (boost::geometry::within(point, polygon)) {
+          EXPECT_TRUE(kernel(point.get<0>(), point.get<1>()));
+        }
+      }
+      for (const auto dx : {-1e-7, 0.0, 1e-7}) {
+        for (const auto dy : {-1e-7, 0.0, 1e-7}) {
+          const auto point = Point(px + dx, py + dy);
+          if (boost::geometry::within(point, polygon) ||
+              !boost::geometry::intersects(point, polygon)) {
+            EXPECT_EQ(kernel(point.get<0>(), point.get<1>()),
+                      boost::geometry::within(point, polygon));
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace gshhg
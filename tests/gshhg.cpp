@@ -0,0 +1,450 @@
+#include "gshhg.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "internals.hpp"
+
+namespace gshhg {
+
+// Gets the shorelines of the crude resolution, loaded once.
+static auto crude() -> const GSHHG& {
+  static const auto instance =
+      GSHHG(data_directory(), std::string("crude"), {}, {});
+  return instance;
+}
+
+// Gets random points uniformly distributed over the globe.
+static auto random_points(const size_t size, const uint64_t seed)
+    -> std::vector<Point> {
+  auto generator = std::mt19937_64(seed);
+  auto lon = std::uniform_real_distribution<double>(-180, 180);
+  auto lat = std::uniform_real_distribution<double>(-90, 90);
+  auto result = std::vector<Point>();
+  for (size_t ix = 0; ix < size; ++ix) {
+    result.emplace_back(lon(generator), lat(generator));
+  }
+  return result;
+}
+
+// Gets the ECEF coordinates of a point expressed in degrees.
+static auto ecef(const Point& point) -> Cartesian {
+  return geodetic_2_cartesian(
+      geodetic_2_radian({point.get<0>(), point.get<1>(), 0}));
+}
+
+// The nearest segment found in the R-tree is at the distance of the nearest
+// segment found by a linear scan of all the segments, with or without hint.
+TEST(GSHHG, NearestSegment) {
+  const auto& instance = crude();
+  const auto segments = GSHHGInternals::segments(instance);
+  ASSERT_FALSE(segments.empty());
+
+  auto hint = std::optional<uint32_t>();
+  for (const auto& item : random_points(500, 0)) {
+    const auto point = ecef(item);
+    auto expected = std::numeric_limits<double>::infinity();
+    for (const auto ix : segments) {
+      expected = std::min(
+          expected, GSHHGInternals::segment_distance(instance, point, ix));
+    }
+    const auto ix = GSHHGInternals::nearest_segment(instance, point);
+    EXPECT_EQ(GSHHGInternals::segment_distance(instance, point, ix),
+              expected);
+    // A hint far from the point doesn't change the distance found.
+    const auto jx = GSHHGInternals::nearest_segment(instance, point, hint);
+    EXPECT_EQ(GSHHGInternals::segment_distance(instance, point, jx),
+              expected);
+    hint = ix;
+  }
+}
+
+// The nearest points of the scalar and batch queries are the closest points
+// of the nearest segments found by a linear scan.
+TEST(GSHHG, Nearest) {
+  const auto& instance = crude();
+  const auto segments = GSHHGInternals::segments(instance);
+  const auto points = random_points(500, 1);
+  auto lon = std::vector<double>();
+  auto lat = std::vector<double>();
+  for (const auto& item : points) {
+    lon.push_back(item.get<0>());
+    lat.push_back(item.get<1>());
+  }
+  auto nearest_lon = std::vector<double>(points.size());
+  auto nearest_lat = std::vector<double>(points.size());
+  instance.nearest(lon.data(), lat.data(), points.size(), nearest_lon.data(),
+                   nearest_lat.data());
+  for (size_t ix = 0; ix < points.size(); ++ix) {
+    const auto point = ecef(points[ix]);
+    auto distance = std::numeric_limits<double>::infinity();
+    auto segment = uint32_t(0);
+    for (const auto jx : segments) {
+      const auto item = GSHHGInternals::segment_distance(instance, point, jx);
+      if (item < distance) {
+        distance = item;
+        segment = jx;
+      }
+    }
+    const auto expected = geodetic_2_degree(cartesian_2_geodetic(
+        closest_point(point, GSHHGInternals::segment(instance, segment))));
+    const auto nearest = instance.nearest(lon[ix], lat[ix]);
+    EXPECT_NEAR(nearest.get<0>(), expected.get<0>(), 1e-9);
+    EXPECT_NEAR(nearest.get<1>(), expected.get<1>(), 1e-9);
+    EXPECT_NEAR(nearest_lon[ix], expected.get<0>(), 1e-9);
+    EXPECT_NEAR(nearest_lat[ix], expected.get<1>(), 1e-9);
+  }
+}
+
+// The k nearest points are the closest points of the segments nearest to
+// the point, a vertex shared by two segments being returned once.
+TEST(GSHHG, KNearest) {
+  constexpr size_t kK = 10;
+  const auto& instance = crude();
+  const auto segments = GSHHGInternals::segments(instance);
+  auto nearest_lon = std::vector<double>(kK);
+  auto nearest_lat = std::vector<double>(kK);
+  auto duplicates = size_t(0);
+  for (const auto& item : random_points(200, 6)) {
+    const auto point = ecef(item);
+    // Closest points of all the segments sorted by distance, without
+    // duplicates.
+    auto closest = std::vector<std::pair<double, std::pair<double, double>>>();
+    for (const auto ix : segments) {
+      const auto nearest = geodetic_2_degree(cartesian_2_geodetic(
+          closest_point(point, GSHHGInternals::segment(instance, ix))));
+      closest.push_back(
+          {GSHHGInternals::segment_distance(instance, point, ix),
+           {nearest.get<0>(), nearest.get<1>()}});
+    }
+    std::sort(closest.begin(), closest.end());
+    const auto size = closest.size();
+    closest.erase(std::unique(closest.begin(), closest.end()), closest.end());
+    duplicates += size - closest.size();
+
+    ASSERT_EQ(instance.nearest(item.get<0>(), item.get<1>(), kK,
+                               nearest_lon.data(), nearest_lat.data()),
+              kK);
+    // The order of the points at the same distance is unspecified.
+    auto found = std::vector<std::pair<double, double>>();
+    auto expected = std::vector<std::pair<double, double>>();
+    for (size_t ix = 0; ix < kK; ++ix) {
+      found.emplace_back(nearest_lon[ix], nearest_lat[ix]);
+      expected.push_back(closest[ix].second);
+    }
+    if (closest[kK - 1].first == closest[kK].first) {
+      continue;
+    }
+    std::sort(found.begin(), found.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(found, expected);
+  }
+  // The nearest points are often vertices.
+  EXPECT_GT(duplicates, 0);
+
+  // Searching for more points than segments finds fewer points than
+  // segments.
+  auto all_lon = std::vector<double>(segments.size() + 1);
+  auto all_lat = std::vector<double>(segments.size() + 1);
+  const auto count = instance.nearest(0.0, 0.0, all_lon.size(),
+                                      all_lon.data(), all_lat.data());
+  EXPECT_GT(count, 0);
+  EXPECT_LT(count, segments.size());
+}
+
+// The mask, the nearest points and their distances computed together are
+// those computed separately.
+TEST(GSHHG, Classify) {
+  const auto& instance = crude();
+  const auto points = random_points(1000, 5);
+  auto lon = std::vector<double>();
+  auto lat = std::vector<double>();
+  for (const auto& item : points) {
+    lon.push_back(item.get<0>());
+    lat.push_back(item.get<1>());
+  }
+  const auto size = points.size();
+  auto level = std::vector<uint8_t>(size);
+  auto nearest_lon = std::vector<double>(size);
+  auto nearest_lat = std::vector<double>(size);
+  auto distance = std::vector<double>(size);
+  instance.classify(lon.data(), lat.data(), size, Andoyer(), level.data(),
+                    nearest_lon.data(), nearest_lat.data(), distance.data());
+
+  auto expected_lon = std::vector<double>(size);
+  auto expected_lat = std::vector<double>(size);
+  auto expected_distance = std::vector<double>(size);
+  instance.nearest(lon.data(), lat.data(), size, expected_lon.data(),
+                   expected_lat.data());
+  instance.distance_to_nearest(lon.data(), lat.data(), size, Andoyer(),
+                               expected_distance.data());
+  for (size_t ix = 0; ix < size; ++ix) {
+    EXPECT_EQ(level[ix], instance.mask(lon[ix], lat[ix]));
+    EXPECT_EQ(nearest_lon[ix], expected_lon[ix]);
+    EXPECT_EQ(nearest_lat[ix], expected_lat[ix]);
+    EXPECT_EQ(distance[ix], expected_distance[ix]);
+  }
+}
+
+// The signed distances computed in a single pass are the distances
+// computed separately, negated on land, and those of the scalar function.
+TEST(GSHHG, SignedDistance) {
+  const auto& instance = crude();
+  const auto points = random_points(1000, 6);
+  auto lon = std::vector<double>();
+  auto lat = std::vector<double>();
+  for (const auto& item : points) {
+    lon.push_back(item.get<0>());
+    lat.push_back(item.get<1>());
+  }
+  const auto size = points.size();
+  auto expected = std::vector<double>(size);
+  instance.distance_to_nearest(lon.data(), lat.data(), size, Andoyer(),
+                               expected.data());
+  // Only the continents and the islands in lakes are land.
+  for (const auto land : {GSHHG::kLand, GSHHG::land_levels({1, 3})}) {
+    auto distance = std::vector<double>(size);
+    instance.signed_distance(lon.data(), lat.data(), size, Andoyer(), land,
+                             distance.data());
+    auto count = size_t(0);
+    for (size_t ix = 0; ix < size; ++ix) {
+      const auto on_land = (land >> instance.mask(lon[ix], lat[ix])) & 1U;
+      count += on_land;
+      EXPECT_EQ(distance[ix], on_land ? -expected[ix] : expected[ix]) << ix;
+      EXPECT_EQ(distance[ix],
+                instance.signed_distance(lon[ix], lat[ix], Andoyer(), land));
+    }
+    EXPECT_GT(count, 0);
+  }
+}
+
+// The polygons clipped by a bounding box, possibly crossing the
+// antimeridian, give the mask of all the polygons inside the box.
+TEST(GSHHG, Clip) {
+  const auto& instance = crude();
+  for (const auto& bbox : {Box({-20, 30}, {40, 70}), Box({100, -60}, {-60, 10}),
+                           Box({-180, -90}, {180, 90})}) {
+    const auto clipped =
+        GSHHG(data_directory(), std::string("crude"), {}, bbox);
+    EXPECT_GT(clipped.polygons(), 0);
+    const auto west = bbox.min_corner().get<0>();
+    auto east = bbox.max_corner().get<0>();
+    if (east < west) {
+      east += 360;
+    }
+    // The points on the edges of the box are skipped: they may lie on the
+    // boundary of the clipped polygons.
+    for (auto lat = bbox.min_corner().get<1>() + 0.3;
+         lat < bbox.max_corner().get<1>(); lat += 0.7) {
+      for (auto lon = west + 0.3; lon < east; lon += 0.7) {
+        EXPECT_EQ(clipped.mask(lon, lat), instance.mask(lon, lat))
+            << lon << " " << lat;
+      }
+    }
+  }
+}
+
+// Gets an instance handling no polygon, to index synthetic ones.
+static auto empty() -> GSHHG {
+  return {data_directory(), std::string("crude"), std::vector<int>{}, {}};
+}
+
+// The point-in-polygon test, processing the edges by blocks, agrees with
+// Boost.Geometry for the points that are not on the boundary of the
+// polygons. The polygons are stored one after the other: their rings start
+// and end in the middle of the blocks.
+TEST(GSHHG, Contains) {
+  auto generator = std::mt19937_64(2);
+  auto polygons = std::vector<std::pair<Polygon, uint8_t>>();
+  for (const size_t size : {3, 31, 32, 33, 64, 65, 100, 1000}) {
+    polygons.emplace_back(star_polygon(size, generator), 1);
+  }
+  auto instance = empty();
+  GSHHGInternals::index(instance, polygons);
+  ASSERT_EQ(instance.polygons(), polygons.size());
+
+  for (size_t ix = 0; ix < polygons.size(); ++ix) {
+    const auto& polygon = polygons[ix].first;
+    auto check = [&](const Point& point) -> void {
+      if (boost::geometry::within(point, polygon) ||
+          !boost::geometry::intersects(point, polygon)) {
+        EXPECT_EQ(GSHHGInternals::contains(instance, ix, point),
+                  boost::geometry::within(point, polygon))
+            << ix << " " << boost::geometry::wkt(point);
+      }
+    };
+    const auto envelope = boost::geometry::return_envelope<Box>(polygon);
+    auto lon = std::uniform_real_distribution<double>(
+        envelope.min_corner().get<0>() - 1, envelope.max_corner().get<0>() + 1);
+    auto lat = std::uniform_real_distribution<double>(
+        envelope.min_corner().get<1>() - 1, envelope.max_corner().get<1>() + 1);
+    for (size_t jx = 0; jx < 1000; ++jx) {
+      check(Point(lon(generator), lat(generator)));
+    }
+    // The points located at the latitude of the vertices, and those close to
+    // them.
+    for (const auto& item : polygon.outer()) {
+      for (const auto dx : {-5.0, -0.5, -1e-7, 0.0, 1e-7, 0.5}) {
+        for (const auto dy : {-1e-7, 0.0, 1e-7}) {
+          check(Point(item.get<0>() + dx, item.get<1>() + dy));
+        }
+      }
+    }
+  }
+}
+
+// The point-in-polygon test of the polygons distributed in latitude bands
+// gives the same result as the test processing the edges by blocks,
+// including for the points located on the limits of the bands and on the
+// vertices, and agrees with Boost.Geometry for the points that are not on
+// the boundary of the polygons.
+TEST(GSHHG, ContainsSlab) {
+  auto generator = std::mt19937_64(3);
+  auto polygons = std::vector<std::pair<Polygon, uint8_t>>();
+  // The closed rings have one more point than vertices.
+  for (const auto size :
+       {GSHHGInternals::kSlabThreshold - 2, GSHHGInternals::kSlabThreshold - 1,
+        GSHHGInternals::kSlabThreshold, uint64_t(3000)}) {
+    polygons.emplace_back(star_polygon(size, generator), 1);
+  }
+  auto instance = empty();
+  GSHHGInternals::index(instance, polygons);
+
+  for (size_t ix = 1; ix < polygons.size(); ++ix) {
+    const auto& polygon = polygons[ix].first;
+    const auto [y0, height, bands] = GSHHGInternals::slabs(instance, ix);
+    ASSERT_GT(bands, 0);
+    auto check = [&](const Point& point) -> void {
+      const auto expected =
+          GSHHGInternals::contains_blocks(instance, ix, point);
+      EXPECT_EQ(GSHHGInternals::contains_slab(instance, ix, point), expected)
+          << ix << " " << boost::geometry::wkt(point);
+      EXPECT_EQ(GSHHGInternals::contains(instance, ix, point), expected);
+      if (boost::geometry::within(point, polygon) ||
+          !boost::geometry::intersects(point, polygon)) {
+        EXPECT_EQ(expected, boost::geometry::within(point, polygon))
+            << ix << " " << boost::geometry::wkt(point);
+      }
+    };
+    const auto envelope = boost::geometry::return_envelope<Box>(polygon);
+    auto lon = std::uniform_real_distribution<double>(
+        envelope.min_corner().get<0>() - 1, envelope.max_corner().get<0>() + 1);
+    auto lat = std::uniform_real_distribution<double>(
+        envelope.min_corner().get<1>() - 1, envelope.max_corner().get<1>() + 1);
+    for (size_t jx = 0; jx < 2000; ++jx) {
+      check(Point(lon(generator), lat(generator)));
+    }
+    // The limits of the bands, including the bottom and the top of the
+    // polygon.
+    for (uint64_t kx = 0; kx <= bands; ++kx) {
+      const auto y = kx == bands ? envelope.max_corner().get<1>()
+                                 : y0 + static_cast<double>(kx) * height;
+      for (size_t jx = 0; jx < 20; ++jx) {
+        check(Point(lon(generator), y));
+      }
+    }
+    for (const auto& item : polygon.outer()) {
+      for (const auto dx : {-0.5, 0.0, 1e-7}) {
+        for (const auto dy : {-1e-7, 0.0}) {
+          check(Point(item.get<0>() + dx, item.get<1>() + dy));
+        }
+      }
+    }
+  }
+  // The smallest polygon is tested by blocks.
+  EXPECT_EQ(std::get<2>(GSHHGInternals::slabs(instance, 0)), 0);
+}
+
+// Gets the mask value of a point by testing, from the last to the first,
+// all the polygons whose envelope contains the point.
+static auto reverse_scan_mask(const GSHHG& instance, const double lon,
+                              const double lat) -> uint8_t {
+  const auto point = Point(normalize_angle(lon, -180.0, 360.0), lat);
+  const auto& levels = GSHHGInternals::levels(instance);
+  const auto& envelopes = GSHHGInternals::envelopes(instance);
+  for (auto ix = instance.polygons(); ix-- > 0;) {
+    if (boost::geometry::covered_by(point, envelopes[ix]) &&
+        boost::geometry::within(point, GSHHGInternals::ring(instance, ix))) {
+      return levels[ix];
+    }
+  }
+  return 0;
+}
+
+// The descent of the containment tree of the polygons gives the mask of the
+// scan of all the polygons, whatever the levels loaded, the bounding box and
+// the acceleration grid.
+TEST(GSHHG, MaskContainmentTree) {
+  const auto selections = std::vector<std::vector<int>>{
+      {1, 2, 3, 5, 6}, {1, 3}, {2}, {1, 2}};
+  const auto boxes = std::vector<std::optional<Box>>{
+      std::nullopt, Box({-20, 30}, {40, 70}), Box({100, -60}, {-60, 10})};
+  auto generator = std::mt19937_64(4);
+  for (const auto& levels : selections) {
+    for (const auto& bbox : boxes) {
+      for (const auto& grid_step : {std::optional<double>(), {1.0}}) {
+        const auto instance = GSHHG(data_directory(), std::string("crude"),
+                                    levels, bbox, grid_step);
+        ASSERT_GT(instance.polygons(), 0);
+        const auto box = bbox.value_or(Box({-180, -90}, {180, 90}));
+        const auto west = box.min_corner().get<0>();
+        auto east = box.max_corner().get<0>();
+        if (east < west) {
+          east += 360;
+        }
+        auto lon = std::uniform_real_distribution<double>(west, east);
+        auto lat = std::uniform_real_distribution<double>(
+            box.min_corner().get<1>(), box.max_corner().get<1>());
+        for (size_t ix = 0; ix < 5000; ++ix) {
+          const auto x = lon(generator);
+          const auto y = lat(generator);
+          EXPECT_EQ(instance.mask(x, y), reverse_scan_mask(instance, x, y))
+              << x << " " << y;
+        }
+      }
+    }
+  }
+}
+
+// The parent of a polygon is found even if its vertices lie on the boundary
+// of a neighbor of its parent, in whose envelope it is nested: two lakes
+// touch the edge shared by two islands, from either side.
+TEST(GSHHG, MaskSharedEdge) {
+  auto polygon = [](const std::vector<Point>& points) -> Polygon {
+    auto result = Polygon();
+    result.outer().assign(points.begin(), points.end());
+    result.outer().push_back(points.front());
+    boost::geometry::correct(result);
+    return result;
+  };
+  auto lake = [&](const double y) -> Polygon {
+    auto points = std::vector<Point>();
+    for (auto x = 1; x < 10; ++x) {
+      points.emplace_back(x, 10);
+    }
+    points.emplace_back(5, y);
+    return polygon(points);
+  };
+  const auto polygons = std::vector<std::pair<Polygon, uint8_t>>{
+      {polygon({{0, 0}, {10, 0}, {10, 10}, {0, 10}}), 1},
+      {polygon({{0, 10}, {10, 10}, {10, 20}, {0, 20}}), 1},
+      {lake(7), 2},
+      {lake(13), 2}};
+  auto instance = empty();
+  GSHHGInternals::index(instance, polygons);
+  ASSERT_EQ(instance.polygons(), polygons.size());
+
+  for (const auto& [x, y, expected] :
+       std::vector<std::tuple<double, double, uint8_t>>{
+           {5, 9, 2}, {5, 11, 2}, {5, 5, 1}, {5, 15, 1}, {1, 9, 1}}) {
+    EXPECT_EQ(instance.mask(x, y), expected) << x << " " << y;
+    EXPECT_EQ(instance.mask(x, y), reverse_scan_mask(instance, x, y));
+  }
+}
+
+}  // namespace gshhg
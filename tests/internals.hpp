@@ -0,0 +1,159 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "gshhg.hpp"
+
+namespace gshhg {
+
+/// Gets the directory containing the shapefiles of the test suite, which
+/// contains only the crude resolution.
+inline auto data_directory() -> std::string { return GSHHG_DATA_DIR; }
+
+/// Gets a random simple polygon: its vertices, sorted by angle around a
+/// center, are located at random distances from it. The ring is closed and
+/// oriented as expected by Boost.Geometry.
+inline auto star_polygon(const size_t size, std::mt19937_64& generator)
+    -> Polygon {
+  auto lon = std::uniform_real_distribution<double>(-150, 150);
+  auto lat = std::uniform_real_distribution<double>(-60, 60);
+  auto radius = std::uniform_real_distribution<double>(1, 10);
+  auto angle = std::uniform_real_distribution<double>(0, two_pi<double>());
+  const auto x = lon(generator);
+  const auto y = lat(generator);
+  auto angles = std::vector<double>(size);
+  for (auto& item : angles) {
+    item = angle(generator);
+  }
+  std::sort(angles.begin(), angles.end());
+  auto result = Polygon();
+  for (const auto item : angles) {
+    const auto r = radius(generator);
+    boost::geometry::append(
+        result, Point(x + r * std::cos(item), y + r * std::sin(item)));
+  }
+  boost::geometry::correct(result);
+  return result;
+}
+
+/// Gives the tests access to the internal structures of GSHHG.
+struct GSHHGInternals {
+  /// Replaces the shorelines handled by an instance by the given polygons,
+  /// associated with their level.
+  static void index(GSHHG& self,
+                    const std::vector<std::pair<Polygon, uint8_t>>& polygons) {
+    auto shorelines = GSHHG::Shorelines();
+    for (const auto& [polygon, level] : polygons) {
+      shorelines.push_back(polygon, level);
+    }
+    self.index(std::move(shorelines));
+  }
+
+  /// Gets the level of each polygon.
+  static auto levels(const GSHHG& self) -> const Buffer<uint8_t>& {
+    return self.levels_;
+  }
+
+  /// Gets the envelope of each polygon.
+  static auto envelopes(const GSHHG& self) -> const Buffer<Box>& {
+    return self.envelopes_;
+  }
+
+  /// Gets the outer ring of a polygon.
+  static auto ring(const GSHHG& self, const size_t ix) -> RingView {
+    return self.ring(ix);
+  }
+
+  /// Tests if a point is inside the outer ring of a polygon.
+  static auto contains(const GSHHG& self, const size_t ix,
+                       const Point& point) -> bool {
+    return self.contains(ix, point);
+  }
+
+  /// Tests if a point is inside the outer ring of a polygon distributed in
+  /// latitude bands.
+  static auto contains_slab(const GSHHG& self, const size_t ix,
+                            const Point& point) -> bool {
+    return self.contains_slab(ix, point);
+  }
+
+  /// Tests if a point is inside the outer ring of a polygon by processing
+  /// its edges by blocks.
+  static auto contains_blocks(const GSHHG& self, const size_t ix,
+                              const Point& point) -> bool {
+    return self.contains_blocks(ix, point);
+  }
+
+  /// Gets the latitude bands of a polygon: the latitude of the first band,
+  /// the height and the number of bands, zero if the polygon isn't
+  /// distributed in bands.
+  static auto slabs(const GSHHG& self, const size_t ix)
+      -> std::tuple<double, double, uint64_t> {
+    const auto& item = self.slabs_[ix];
+    return {item.y0, item.height, item.size};
+  }
+
+  /// Gets the minimum number of points of the polygons distributed in
+  /// latitude bands.
+  static constexpr auto kSlabThreshold = GSHHG::kSlabThreshold;
+
+  /// Gets the cache file mapped by the instance, if any.
+  static auto file(const GSHHG& self) -> const MappedFile* {
+    return self.file_.get();
+  }
+
+  /// Gets the spatial index of the polygon envelopes.
+  static auto polygon_rtree(const GSHHG& self) -> const PackedRTree<2>& {
+    return self.polygon_rtree_;
+  }
+
+  /// Gets the spatial index of the coastline segments.
+  static auto rtree(const GSHHG& self) -> const PackedRTree<3>& {
+    return self.rtree_;
+  }
+
+  /// Gets the offset of the outer ring of each polygon.
+  static auto offsets(const GSHHG& self) -> const Buffer<uint64_t>& {
+    return self.offsets_;
+  }
+
+  /// Gets the index of the first point of each coastline segment.
+  static auto segments(const GSHHG& self) -> std::vector<uint32_t> {
+    auto result = std::vector<uint32_t>();
+    for (size_t ix = 0; ix < self.polygons(); ++ix) {
+      for (auto jx = self.offsets_[ix]; jx + 1 < self.offsets_[ix + 1];
+           ++jx) {
+        result.push_back(static_cast<uint32_t>(jx));
+      }
+    }
+    return result;
+  }
+
+  /// Gets the coastline segment starting at the given point.
+  static auto segment(const GSHHG& self, const uint32_t ix)
+      -> CartesianSegment {
+    return self.segment(ix);
+  }
+
+  /// Gets the comparable distance between a point and a coastline segment.
+  static auto segment_distance(const GSHHG& self, const Cartesian& point,
+                               const uint32_t ix) -> double {
+    return self.segment_distance(point, ix);
+  }
+
+  /// Gets the nearest coastline segment of a point searched in the R-tree.
+  static auto nearest_segment(const GSHHG& self, const Cartesian& point,
+                              const std::optional<uint32_t>& hint = {})
+      -> uint32_t {
+    return self.nearest_segment(point, hint);
+  }
+};
+
+}  // namespace gshhg
@@ -0,0 +1,16 @@
+#include <gshhg.hpp>
+#include <iostream>
+
+// Loads the crude shorelines and queries a point inland and a point at sea.
+auto main() -> int {
+  const auto instance =
+      gshhg::GSHHG(GSHHG_DATA_DIR, std::string("crude"), {}, {});
+  const auto paris = instance.mask(2.35, 48.85);
+  const auto atlantic = instance.mask(-30, 30);
+  if (paris != 1 || atlantic != 0) {
+    std::cerr << "unexpected mask: " << int(paris) << ", " << int(atlantic)
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,183 @@
+#include "rtree.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace gshhg {
+
+using Tree = PackedRTree<2>;
+
+// Gets random boxes, of various sizes, covering the globe.
+static auto random_boxes(const size_t size, const uint64_t seed)
+    -> std::vector<Tree::Item> {
+  auto generator = std::mt19937_64(seed);
+  auto lon = std::uniform_real_distribution<double>(-180, 180);
+  auto lat = std::uniform_real_distribution<double>(-90, 90);
+  auto extent = std::uniform_real_distribution<double>(0, 20);
+  auto result = std::vector<Tree::Item>();
+  for (size_t ix = 0; ix < size; ++ix) {
+    const auto x = lon(generator);
+    const auto y = lat(generator);
+    result.emplace_back(
+        Tree::Bounds{x, y, x + extent(generator), y + extent(generator)},
+        static_cast<uint32_t>(ix));
+  }
+  return result;
+}
+
+// Gets the items containing the point, searched by a linear scan.
+static auto brute_force(const std::vector<Tree::Item>& items,
+                        const Tree::Coordinates& point)
+    -> std::vector<uint32_t> {
+  auto result = std::vector<uint32_t>();
+  for (const auto& [bounds, ix] : items) {
+    if (bounds[0] <= point[0] && point[0] <= bounds[2] &&
+        bounds[1] <= point[1] && point[1] <= bounds[3]) {
+      result.push_back(ix);
+    }
+  }
+  return result;
+}
+
+// Gets the items containing the point, searched in the tree.
+static auto candidates(const Tree& tree, const Tree::Coordinates& point)
+    -> std::vector<uint32_t> {
+  auto result = std::vector<uint32_t>();
+  tree.query(point, [&result](const uint32_t ix) { result.push_back(ix); });
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+TEST(PackedRTree, Empty) {
+  const auto tree = Tree::build({});
+  EXPECT_TRUE(tree.empty());
+  EXPECT_EQ(tree.size(), 0);
+  EXPECT_TRUE(candidates(tree, {0, 0}).empty());
+}
+
+// The candidate polygons of the mask are the items whose envelope contains
+// the point, whatever the number of levels of the tree.
+TEST(PackedRTree, QueryPoint) {
+  for (const auto size : {1, 15, 16, 17, 256, 5000}) {
+    const auto items = random_boxes(static_cast<size_t>(size), size);
+    const auto tree = Tree::build(items);
+    ASSERT_EQ(tree.size(), items.size());
+
+    auto generator = std::mt19937_64(0);
+    auto lon = std::uniform_real_distribution<double>(-180, 200);
+    auto lat = std::uniform_real_distribution<double>(-90, 110);
+    for (size_t ix = 0; ix < 1000; ++ix) {
+      const auto point = Tree::Coordinates{lon(generator), lat(generator)};
+      EXPECT_EQ(candidates(tree, point), brute_force(items, point));
+    }
+  }
+}
+
+// The bounds are closed: the points located on the edges or the corners of
+// the envelopes are candidates.
+TEST(PackedRTree, QueryBoundary) {
+  const auto items = random_boxes(1000, 1);
+  const auto tree = Tree::build(items);
+  for (const auto& [bounds, ix] : items) {
+    for (const auto& point : {Tree::Coordinates{bounds[0], bounds[1]},
+                              Tree::Coordinates{bounds[2], bounds[3]},
+                              Tree::Coordinates{bounds[0], bounds[3]},
+                              Tree::Coordinates{bounds[2], bounds[1]}}) {
+      const auto result = candidates(tree, point);
+      EXPECT_TRUE(std::binary_search(result.begin(), result.end(), ix));
+      EXPECT_EQ(result, brute_force(items, point));
+    }
+  }
+}
+
+// The predicate prunes the nodes: the boxes overlapping a query box are
+// those found by a linear scan.
+TEST(PackedRTree, QueryPredicate) {
+  const auto items = random_boxes(3000, 2);
+  const auto tree = Tree::build(items);
+  const auto query = Tree::Bounds{-30, -10, 45, 25};
+  auto overlaps = [&query](const Tree::Bounds& bounds) -> bool {
+    return bounds[0] <= query[2] && bounds[2] >= query[0] &&
+           bounds[1] <= query[3] && bounds[3] >= query[1];
+  };
+  auto expected = std::vector<uint32_t>();
+  for (const auto& [bounds, ix] : items) {
+    if (overlaps(bounds)) {
+      expected.push_back(ix);
+    }
+  }
+  auto result = std::vector<uint32_t>();
+  tree.query(overlaps, [&result](const uint32_t ix) { result.push_back(ix); });
+  std::sort(result.begin(), result.end());
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(result, expected);
+}
+
+// A tree rebuilt from its serialized representation, like the one mapped
+// from a cache file, gives the same candidates.
+TEST(PackedRTree, Serialized) {
+  const auto items = random_boxes(1000, 3);
+  const auto tree = Tree::build(items);
+  const auto copy =
+      Tree(Buffer<Tree::Bounds>(tree.bounds().data(), tree.bounds().size()),
+           Buffer<uint32_t>(tree.indices().data(), tree.indices().size()),
+           Buffer<uint64_t>(tree.levels().data(), tree.levels().size()));
+  for (const auto& [bounds, ix] : items) {
+    const auto point = Tree::Coordinates{(bounds[0] + bounds[2]) / 2,
+                                         (bounds[1] + bounds[3]) / 2};
+    EXPECT_EQ(candidates(copy, point), candidates(tree, point));
+  }
+}
+
+// Among the items at the same distance, the nearest item is the one with
+// the lowest index, whatever the hint: the batch queries, whose hint is the
+// item found for the previous point, return the same items as the scalar
+// queries.
+TEST(PackedRTree, NearestTie) {
+  // Items sharing the same bounds, spread over several leaves
+  auto items = std::vector<Tree::Item>();
+  for (uint32_t ix = 0; ix < 100; ++ix) {
+    items.emplace_back(Tree::Bounds{1, 1, 2, 2}, ix);
+  }
+  const auto tree = Tree::build(items);
+  const auto constant = [](const uint32_t) -> double { return 2; };
+  for (const auto hint : {std::optional<uint32_t>(), std::optional<uint32_t>(0),
+                          std::optional<uint32_t>(57),
+                          std::optional<uint32_t>(99)}) {
+    const auto result = tree.nearest({0, 0}, constant, hint);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->first, 0);
+    EXPECT_EQ(result->second, 2);
+  }
+
+  // Random items whose distances are rounded up, so that many are equal
+  // while remaining bounded by the distances of the nodes
+  const auto random = random_boxes(2000, 4);
+  const auto indexed = Tree::build(random);
+  auto generator = std::mt19937_64(5);
+  auto lon = std::uniform_real_distribution<double>(-180, 180);
+  auto lat = std::uniform_real_distribution<double>(-90, 90);
+  auto index = std::uniform_int_distribution<uint32_t>(0, 1999);
+  for (size_t ix = 0; ix < 1000; ++ix) {
+    const auto point = Tree::Coordinates{lon(generator), lat(generator)};
+    const auto distance = [&](const uint32_t jx) -> double {
+      return std::ceil(Tree::min_distance(point, random[jx].first) / 100) *
+             100;
+    };
+    auto expected = std::make_pair(uint32_t(0), distance(0));
+    for (uint32_t jx = 1; jx < random.size(); ++jx) {
+      if (distance(jx) < expected.second) {
+        expected = {jx, distance(jx)};
+      }
+    }
+    EXPECT_EQ(indexed.nearest(point, distance), expected);
+    EXPECT_EQ(indexed.nearest(point, distance, index(generator)), expected);
+  }
+}
+
+}  // namespace gshhg
@@ -0,0 +1,143 @@
+#include "thread.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace gshhg {
+
+// Each iteration of a loop is processed once, whatever the number of
+// threads.
+TEST(ThreadPool, Dispatch) {
+  for (const auto num_threads : {0, 1, 2, 64}) {
+    for (const auto size : {0, 1, 7, 10000}) {
+      auto counts = std::vector<std::atomic<int>>(static_cast<size_t>(size));
+      dispatch(
+          [&counts](const size_t start, const size_t end) {
+            for (auto ix = start; ix < end; ++ix) {
+              ++counts[ix];
+            }
+          },
+          counts.size(), static_cast<size_t>(num_threads));
+      for (const auto& item : counts) {
+        EXPECT_EQ(item, 1);
+      }
+    }
+  }
+}
+
+// The loops may be nested: the threads of the pool running an outer loop
+// take part in the inner loops instead of waiting for them. The pool is
+// created with several workers, whatever the number of CPUs.
+TEST(ThreadPool, Nested) {
+  constexpr size_t kOuter = 64;
+  constexpr size_t kInner = 1000;
+  auto pool = ThreadPool(3);
+  auto counts = std::vector<std::atomic<int>>(kOuter * kInner);
+  pool.parallel_for(
+      [&](const size_t start, const size_t end) {
+        for (auto ix = start; ix < end; ++ix) {
+          pool.parallel_for(
+              [&counts, ix](const size_t first, const size_t last) {
+                for (auto jx = first; jx < last; ++jx) {
+                  ++counts[ix * kInner + jx];
+                }
+              },
+              kInner, 4);
+        }
+      },
+      kOuter, 4);
+  for (const auto& item : counts) {
+    EXPECT_EQ(item, 1);
+  }
+}
+
+// The first exception thrown by an inner loop is rethrown by the outer loop,
+// and the pool remains usable.
+TEST(ThreadPool, NestedException) {
+  auto pool = ThreadPool(3);
+  EXPECT_THROW(pool.parallel_for(
+                   [&pool](const size_t start, const size_t end) {
+                     for (auto ix = start; ix < end; ++ix) {
+                       pool.parallel_for(
+                           [ix](const size_t first, const size_t) {
+                             if (ix == 3 && first == 0) {
+                               throw std::runtime_error("inner");
+                             }
+                           },
+                           100, 4);
+                     }
+                   },
+                   16, 4),
+               std::runtime_error);
+
+  auto total = std::atomic<size_t>(0);
+  pool.parallel_for(
+      [&total](const size_t start, const size_t end) {
+        total += end - start;
+      },
+      1000, 4);
+  EXPECT_EQ(total, 1000);
+}
+
+#ifndef _WIN32
+// Runs a loop on the pool of the process, and checks that each iteration
+// is processed once and that the workers of the pool take part in it.
+static auto run_loop() -> bool {
+  auto& pool = ThreadPool::instance();
+  auto counts = std::vector<std::atomic<int>>(1000);
+  auto mutex = std::mutex();
+  auto threads = std::set<std::thread::id>();
+  pool.parallel_for(
+      [&](const size_t start, const size_t end) {
+        {
+          auto lock = std::lock_guard<std::mutex>(mutex);
+          threads.insert(std::this_thread::get_id());
+        }
+        for (auto ix = start; ix < end; ++ix) {
+          ++counts[ix];
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      },
+      counts.size(), pool.size() + 1);
+  for (const auto& item : counts) {
+    if (item != 1) {
+      return false;
+    }
+  }
+  return pool.size() == 0 || threads.size() > 1;
+}
+
+// A child process created after a parallel loop creates its own pool,
+// whose threads process the loops.
+TEST(ThreadPool, Fork) {
+  ASSERT_TRUE(run_loop());
+  const auto* parent = &ThreadPool::instance();
+  const auto pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    const auto* child = &ThreadPool::instance();
+    _exit(child != parent && run_loop() && run_loop() ? 0 : 1);
+  }
+  auto status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  // The pool of the parent is unchanged.
+  EXPECT_EQ(&ThreadPool::instance(), parent);
+  EXPECT_TRUE(run_loop());
+}
+#endif
+
+}  // namespace gshhg